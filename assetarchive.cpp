@@ -0,0 +1,48 @@
+#include "assetarchive.h"
+#include <algorithm>
+#include <cstring>
+
+uint64_t fnv1a(const void *data, const size_t size, uint64_t hash)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+AssetArchive::AssetArchive(const std::string &filename) : m_file(filename)
+{
+    if (!m_file.isOpen() || m_file.size() < sizeof(AssetArchiveHeader))
+        return;
+    const AssetArchiveHeader *header = (const AssetArchiveHeader *)m_file.data();
+    if (header->magic != kAssetArchiveMagic || header->version != kAssetArchiveVersion ||
+        sizeof(AssetArchiveHeader) + header->entryCount * sizeof(AssetEntry) > m_file.size())
+        return;
+    const AssetEntry *entries = (const AssetEntry *)(m_file.data() + sizeof(AssetArchiveHeader));
+    for (size_t i = 0; i < header->entryCount; ++i)
+        if (entries[i].offset > m_file.size() || entries[i].size > m_file.size() - entries[i].offset ||
+            entries[i].name[sizeof(entries[i].name) - 1] != '\0')
+            return; // truncated or corrupted: behave as if there was no archive
+    m_entries = entries;
+    m_entryCount = header->entryCount;
+}
+
+bool AssetArchive::isOpen() const { return m_entries != nullptr; }
+
+size_t AssetArchive::size() const { return m_entryCount; }
+
+const AssetEntry &AssetArchive::entry(const size_t index) const { return m_entries[index]; }
+
+const AssetEntry *AssetArchive::find(const std::string &name) const
+{
+    const AssetEntry *end = m_entries + m_entryCount;
+    const AssetEntry *it = std::lower_bound(m_entries, end, name, [](const AssetEntry &entry, const std::string &key) {
+        return std::strcmp(entry.name, key.c_str()) < 0;
+    });
+    return it != end && name == it->name ? it : nullptr;
+}
+
+const unsigned char *AssetArchive::data(const AssetEntry &entry) const { return m_file.data() + entry.offset; }
@@ -0,0 +1,65 @@
+#ifndef ASSETARCHIVE_H
+#define ASSETARCHIVE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "mappedfile.h"
+
+// Packed assets written by the cookAssets tool (tools/cook.cpp) and memory-mapped at startup.
+// File layout: AssetArchiveHeader, the AssetEntry table sorted by name, then the payloads aligned on kAssetAlignment.
+// Payloads are ready for the GPU: nothing is decoded nor generated when loading them.
+const uint32_t kAssetArchiveMagic = 0x4B415054; // "TPAK"
+const uint32_t kAssetArchiveVersion = 1;
+const size_t kAssetAlignment = 16;
+
+enum class AssetType : uint32_t
+{
+  Texture, // pixels as decoded by stb_image: width * height * channels bytes, rows from the top
+  Shader,  // GLSL source, not zero-terminated
+  Mesh     // positions (3 floats), normals (3 floats), texcoords (2 floats) per vertex, then 32-bit indices
+};
+
+struct AssetArchiveHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t reserved;
+};
+
+struct AssetEntry
+{
+  char name[56];        // zero-terminated, e.g., "media/earth.jpg" or "mesh/0/64"
+  uint64_t contentHash; // of the cooking input, so that unchanged inputs are not cooked again
+  uint64_t offset;      // of the payload, from the start of the file
+  uint64_t size;        // of the payload, in bytes
+  AssetType type;
+  uint32_t width, height, channels;            // Texture
+  uint32_t vertexCount, indexCount, primitive; // Mesh
+  uint32_t reserved;
+};
+static_assert(sizeof(AssetEntry) == 112, "AssetEntry is part of the file format");
+
+// 64-bit FNV-1a hash; pass the previous result as hash to chain several blocks
+uint64_t fnv1a(const void *data, const size_t size, uint64_t hash = 14695981039346656037ull);
+
+// Read-only view of an archive; entries and payloads point into the mapping
+class AssetArchive
+{
+public:
+  explicit AssetArchive(const std::string &filename);
+
+  bool isOpen() const; // false if the file is missing or is not a valid archive
+  size_t size() const; // number of entries
+  const AssetEntry &entry(const size_t index) const;
+  const AssetEntry *find(const std::string &name) const; // nullptr if absent
+  const unsigned char *data(const AssetEntry &entry) const;
+
+private:
+  MappedFile m_file;
+  const AssetEntry *m_entries = nullptr;
+  size_t m_entryCount = 0;
+};
+
+#endif // ASSETARCHIVE_H
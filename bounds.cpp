@@ -0,0 +1,155 @@
+#include "bounds.h"
+#include <algorithm>
+#include <cmath>
+
+bool Aabb::isEmpty() const
+{
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+void Aabb::extend(const glm::vec3 &point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+// Gribb and Hartmann: each plane is a sum or difference of the last row and another row of the matrix
+Frustum Frustum::fromMatrix(const glm::mat4 &m)
+{
+    const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+    for (glm::vec4 &plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+bool Frustum::intersects(const BoundingSphere &sphere) const
+{
+    if (sphere.radius < 0)
+        return false;
+    for (const glm::vec4 &plane : planes)
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+            return false;
+    return true;
+}
+
+bool Frustum::intersects(const Aabb &box) const
+{
+    if (box.isEmpty())
+        return false;
+    for (const glm::vec4 &plane : planes)
+    {
+        // corner of the box the farthest along the plane normal
+        const glm::vec3 corner(plane.x >= 0 ? box.max.x : box.min.x, plane.y >= 0 ? box.max.y : box.min.y,
+                               plane.z >= 0 ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::contains(const Aabb &box) const
+{
+    if (box.isEmpty())
+        return false;
+    for (const glm::vec4 &plane : planes)
+    {
+        // corner of the box the farthest against the plane normal
+        const glm::vec3 corner(plane.x >= 0 ? box.min.x : box.max.x, plane.y >= 0 ? box.min.y : box.max.y,
+                               plane.z >= 0 ? box.min.z : box.max.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+            return false;
+    }
+    return true;
+}
+
+bool intersectRay(const BoundingSphere &sphere, const glm::vec3 &origin, const glm::vec3 &direction, float &t)
+{
+    if (sphere.radius < 0)
+        return false;
+    const glm::vec3 oc = origin - sphere.center;
+    const float b = glm::dot(oc, direction);
+    const float c = glm::dot(oc, oc) - sphere.radius * sphere.radius;
+    if (c > 0 && b > 0)
+        return false; // outside and pointing away
+    // r^2 - squared distance from the center to the line, rather than b^2 - c which cancels badly for
+    // small spheres far from the origin
+    const glm::vec3 closest = oc - b * direction;
+    const float discriminant = sphere.radius * sphere.radius - glm::dot(closest, closest);
+    if (discriminant < 0)
+        return false;
+    t = std::max(0.0f, -b - std::sqrt(discriminant));
+    return true;
+}
+
+// slab test
+bool intersectRay(const Aabb &box, const glm::vec3 &origin, const glm::vec3 &invDirection, const float maxT, float &t)
+{
+    const glm::vec3 t0 = (box.min - origin) * invDirection;
+    const glm::vec3 t1 = (box.max - origin) * invDirection;
+    const glm::vec3 lo = glm::min(t0, t1), hi = glm::max(t0, t1);
+    const float enter = std::max(std::max(lo.x, lo.y), std::max(lo.z, 0.0f));
+    const float exit = std::min(std::min(hi.x, hi.y), std::min(hi.z, maxT));
+    t = enter;
+    return enter <= exit;
+}
+
+bool intersects(const BoundingSphere &sphere, const Aabb &box)
+{
+    const glm::vec3 d = sphere.center - glm::clamp(sphere.center, box.min, box.max);
+    return sphere.radius >= 0 && glm::dot(d, d) <= sphere.radius * sphere.radius;
+}
+
+Aabb computeAabb(const FloatArray &positions)
+{
+    Aabb box;
+    for (size_t i = 0; i + 2 < positions.size(); i += 3)
+        box.extend(glm::vec3(positions[i], positions[i + 1], positions[i + 2]));
+    return box;
+}
+
+BoundingSphere boundingSphereOf(const Aabb &box)
+{
+    BoundingSphere sphere;
+    if (box.isEmpty())
+        return sphere;
+    sphere.center = (box.min + box.max) * 0.5f;
+    sphere.radius = 0.5f * glm::length(box.max - box.min);
+    return sphere;
+}
+
+BoundingSphere transformSphere(const BoundingSphere &sphere, const glm::mat4 &m)
+{
+    BoundingSphere result;
+    if (sphere.radius < 0)
+        return result;
+    const float scale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+    result.center = glm::vec3(m * glm::vec4(sphere.center, 1.0f));
+    result.radius = sphere.radius * scale;
+    return result;
+}
+
+BoundingSphere computeBoundingSphere(const FloatArray &positions, const Aabb &box)
+{
+    BoundingSphere sphere;
+    if (box.isEmpty())
+        return sphere;
+    sphere.center = (box.min + box.max) * 0.5f;
+    float radius2 = 0.0f;
+    for (size_t i = 0; i + 2 < positions.size(); i += 3)
+    {
+        const glm::vec3 d = glm::vec3(positions[i], positions[i + 1], positions[i + 2]) - sphere.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    sphere.radius = std::sqrt(radius2);
+    return sphere;
+}
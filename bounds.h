@@ -0,0 +1,54 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "meshdata.h"
+
+// Axis-aligned bounding box; min > max when empty
+struct Aabb
+{
+  glm::vec3 min = glm::vec3(1e30f);
+  glm::vec3 max = glm::vec3(-1e30f);
+
+  bool isEmpty() const;
+  void extend(const glm::vec3 &point);
+};
+
+struct BoundingSphere
+{
+  glm::vec3 center = glm::vec3(0.0f);
+  float radius = -1.0f; // negative when empty
+};
+
+// View frustum as six normalized planes (a, b, c, d), a point p being inside when dot(abc, p) + d >= 0
+struct Frustum
+{
+  glm::vec4 planes[6]; // left, right, bottom, top, near, far
+
+  // Planes of a projection * view (* model) matrix, in the space the matrix transforms from
+  static Frustum fromMatrix(const glm::mat4 &m);
+  // Conservative: may return true for volumes near the corners that are actually outside
+  bool intersects(const BoundingSphere &sphere) const;
+  bool intersects(const Aabb &box) const;
+  // Whether the whole box is inside
+  bool contains(const Aabb &box) const;
+};
+
+// Ray tests; direction must be normalized. t is the distance from the origin to the entry point (0 if inside).
+bool intersectRay(const BoundingSphere &sphere, const glm::vec3 &origin, const glm::vec3 &direction, float &t);
+// invDirection: 1 / direction, per component; only hits closer than maxT count
+bool intersectRay(const Aabb &box, const glm::vec3 &origin, const glm::vec3 &invDirection, const float maxT, float &t);
+// Whether the sphere and the box overlap
+bool intersects(const BoundingSphere &sphere, const Aabb &box);
+
+// Bounds of xyz position triplets [x0, y0, z0, x1, y1, z1, ...]
+Aabb computeAabb(const FloatArray &positions);
+// Sphere through the corners of the box
+BoundingSphere boundingSphereOf(const Aabb &box);
+// Sphere holding the transformed sphere (the radius grows with the largest scale of the matrix)
+BoundingSphere transformSphere(const BoundingSphere &sphere, const glm::mat4 &m);
+// Sphere centered on the box, through the farthest position: not the smallest one, but tight for the usual meshes
+BoundingSphere computeBoundingSphere(const FloatArray &positions, const Aabb &box);
+
+#endif // BOUNDS_H
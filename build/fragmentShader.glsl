@@ -1,29 +1,49 @@
 #version 330 core	     // Minimal GL version support expected from the GPU
 
-uniform vec3 camPos;
-uniform vec3 lColor;
-uniform vec3 lightPos;
-uniform vec3 emission;
+// camera and light, filled once per frame (FrameData in shaderprogram.h)
+layout(std140) uniform FrameData {
+	mat4 viewMat;
+	mat4 projMat;
+	vec3 camPos;
+	vec3 lightPos;
+};
 in vec3 fPosition;
 in vec3 fNormal;
 in vec2 fTexCoord;
-out vec4 color;	  // Shader output: the color response attached to this fragment
+flat in vec3 fLColor;   // light color, per draw or per instance
+flat in vec3 fEmission;
+flat in uint fPickId;
+flat in float fAlbedoLayer; // layer of material.albedoTex, per draw or per instance
+#ifdef TERRAIN
+in vec3 fSphereDir;
+#endif
+layout(location = 0) out vec4 color;	  // Shader output: the color response attached to this fragment
+layout(location = 1) out uint fragPickId; // only stored by the IdBuffer pass, which has no buffer for the color
 
 struct Material {
-	sampler2D albedoTex;
+	sampler2DArray albedoTex; // the albedo maps of every body, see loadTextureArrayFromFilesToGPU()
 };
 uniform Material material;
 
 void main() {
-	vec3 texColor = texture(material.albedoTex, fTexCoord).rgb;
+#ifdef TERRAIN
+	// same mapping as the texture coordinates of Mesh::genSphere, per fragment
+	const float PI = 3.14159265358979;
+	vec3 d = normalize(fSphereDir);
+	vec2 texCoord = vec2(atan(d.y, d.x) / (2.0 * PI), acos(clamp(d.z, -1.0, 1.0)) / PI);
+#else
+	vec2 texCoord = fTexCoord;
+#endif
+	vec3 texColor = texture(material.albedoTex, vec3(texCoord, fAlbedoLayer)).rgb;
 	vec3 n = normalize(fNormal);
 	vec3 l = normalize(lightPos - fPosition); // light direction vector
 	vec3 viewV = normalize(camPos - fPosition);
 	vec3 refV = normalize(reflect(-l, n));
-	vec3 ambient = lColor;
-	vec3 diffuse = max(dot(n, l), 0.0) * lColor;
-	vec3 specular = pow(max(dot(viewV, refV), 0.0), 32) *  lColor;
-	vec3 finalColor = (ambient + diffuse) * texColor + specular + emission;
+	vec3 ambient = fLColor;
+	vec3 diffuse = max(dot(n, l), 0.0) * fLColor;
+	vec3 specular = pow(max(dot(viewV, refV), 0.0), 32) *  fLColor;
+	vec3 finalColor = (ambient + diffuse) * texColor + specular + fEmission;
 	color = vec4(finalColor, 1.0); // build an RGBA from an RGB
+	fragPickId = fPickId;
 	//color = vec4(n, 1.0);
 }
@@ -1,18 +1,190 @@
 #version 330 core            // Minimal GL version support expected from the GPU
 
+#ifdef PROCEDURAL_SPHERE
+uniform int sphereResolution; // no vertex attribute: the sphere is rebuilt from gl_VertexID
+#elif defined(TERRAIN)
+layout(location=0) in vec2 vGrid; // integer coordinates in the patch grid, see PlanetTerrain
+#else
 layout(location=0) in vec3 vPosition;
 layout(location=1) in vec3 vNormal;
 layout(location = 2) in vec2 vTexCoord;
+#endif
 
-uniform mat4 viewMat, projMat, modelMat;
+#if defined(INSTANCED)
+// per-instance model matrix and material, advanced once per instance (glVertexAttribDivisor), see Mesh::renderInstanced
+layout(location = 3) in mat4 iModelMat; // uses locations 3 to 6
+layout(location = 7) in vec3 iLColor;
+layout(location = 8) in vec3 iEmission;
+layout(location = 9) in float iAlbedoLayer;
+#else
+uniform vec3 lColor;
+uniform vec3 emission;
+uniform float albedoLayer; // in material.albedoTex
+#endif
+#if defined(ORBITAL)
+// static per-instance orbit, the model matrix is rebuilt from the time
+layout(location = 3) in vec4 iOrbit; // radius, phase, orbit speed, spin speed
+layout(location = 4) in vec2 iBody;  // axial tilt, scale
+uniform float time;
+#elif !defined(INSTANCED)
+uniform mat4 modelMat;
+#endif
+
+// camera and light, filled once per frame (FrameData in shaderprogram.h)
+layout(std140) uniform FrameData {
+        mat4 viewMat;
+        mat4 projMat;
+        vec3 camPos;
+        vec3 lightPos;
+};
+uniform vec3 posOffset, posScale; // position decoding, identity for the float layouts
+uniform float octScale;           // > 0 when the normals are octahedral-encoded integers
+uniform vec2 uvOffset, uvScale;   // texcoord decoding, identity for the float layouts
+uniform uint pickId;              // id written for picking, see IdBuffer; per instance, the first one
 out vec3 fNormal;
 out vec3 fPosition;
 out vec2 fTexCoord;
+flat out vec3 fLColor;
+flat out vec3 fEmission;
+flat out uint fPickId;
+flat out float fAlbedoLayer;
+#ifdef TERRAIN
+out vec3 fSphereDir; // the fragment shader computes the texture coordinates: interpolating them would smear the seam
+#endif
+
+// Unfolds an octahedral-encoded normal, see octEncode() in mesh.cpp
+vec3 octDecode(vec2 e) {
+        vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+        float t = max(-n.z, 0.0);
+        n.x += n.x >= 0.0 ? -t : t;
+        n.y += n.y >= 0.0 ? -t : t;
+        return normalize(n);
+}
+
+#ifdef PROCEDURAL_SPHERE
+// Vertex gl_VertexID of the UV sphere of Mesh::genSphere drawn as a triangle list with 6 vertices per quad
+void proceduralSphereVertex(out vec3 position, out vec3 normal, out vec2 texCoord) {
+        const float PI = 3.14159265358979;
+        // corners of the CCW triangles (k1, k2, k1+1) and (k1+1, k2, k2+1), as (stack, sector) offsets
+        const ivec2 corners[6] = ivec2[6](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(0, 1), ivec2(1, 0), ivec2(1, 1));
+        int quad = gl_VertexID / 6;
+        ivec2 ij = ivec2(quad / sphereResolution, quad % sphereResolution) + corners[gl_VertexID % 6];
+        float stackAngle = PI / 2.0 - float(ij.x) * PI / float(sphereResolution); // from pi/2 to -pi/2
+        float sectorAngle = float(ij.y) * 2.0 * PI / float(sphereResolution);     // from 0 to 2pi
+        position = vec3(cos(stackAngle) * cos(sectorAngle), cos(stackAngle) * sin(sectorAngle), sin(stackAngle));
+        normal = position;
+        texCoord = vec2(ij.y, ij.x) / float(sphereResolution);
+}
+#endif
+
+#ifdef TERRAIN
+// per-instance patch, see PlanetTerrain::render
+layout(location = 3) in vec4 iPatch; // lower corner on the cube face in [-1, 1]^2, size, quadtree depth
+layout(location = 4) in float iFace;
+uniform float gridSize;      // quads per patch side
+uniform vec2 morphRange;     // where the morph of the depth-0 patches starts and ends, halved at each depth
+uniform vec3 cameraLocal;    // camera position in object space
+uniform float heightScale;   // relief, relative to the radius
+uniform sampler2D heightMap; // equirectangular, in [0, 1]
+
+// cube face axes u, v and normal, as kFaces in terrain.cpp
+const mat3 kFaceBasis[6] = mat3[6](
+        mat3(0, 1, 0, 0, 0, 1, 1, 0, 0), mat3(0, 0, 1, 0, 1, 0, -1, 0, 0),
+        mat3(0, 0, 1, 1, 0, 0, 0, 1, 0), mat3(1, 0, 0, 0, 0, 1, 0, -1, 0),
+        mat3(1, 0, 0, 0, 1, 0, 0, 0, 1), mat3(0, 1, 0, 1, 0, 0, 0, 0, -1));
+
+// Same mapping as the texture coordinates of Mesh::genSphere
+vec2 sphereTexCoord(vec3 d) {
+        const float PI = 3.14159265358979;
+        return vec2(atan(d.y, d.x) / (2.0 * PI), acos(clamp(d.z, -1.0, 1.0)) / PI);
+}
+
+// Spherified cube, same as spherify() in terrain.cpp
+vec3 spherify(mat3 faceBasis, vec2 f) {
+        vec3 p = faceBasis * vec3(f, 1.0);
+        vec3 p2 = p * p;
+        return normalize(p * sqrt(1.0 - p2.yzx / 2.0 - p2.zxy / 2.0 + p2.yzx * p2.zxy / 3.0));
+}
+
+vec3 terrainPoint(mat3 faceBasis, vec2 f) {
+        vec3 d = spherify(faceBasis, f);
+        return d * (1.0 + heightScale * textureLod(heightMap, sphereTexCoord(d), 0.0).r);
+}
+
+// CDLOD vertex: the odd grid vertices slide onto the parent grid as the distance reaches the end of the range,
+// so that the patch matches its coarser neighbours there
+void terrainVertex(out vec3 position, out vec3 normal) {
+        mat3 faceBasis = kFaceBasis[int(iFace)];
+        vec2 patchOrigin = iPatch.xy;
+        float patchSize = iPatch.z;
+        vec2 range = morphRange / exp2(iPatch.w);
+        vec2 f = patchOrigin + vGrid / gridSize * patchSize;
+        float k = clamp((distance(cameraLocal, spherify(faceBasis, f)) - range.x) / (range.y - range.x), 0.0, 1.0);
+        vec2 grid = vGrid - fract(vGrid * 0.5) * 2.0 * k;
+        f = patchOrigin + grid / gridSize * patchSize;
+        position = terrainPoint(faceBasis, f);
+        float e = patchSize / gridSize; // central differences over one grid cell
+        vec3 du = terrainPoint(faceBasis, f + vec2(e, 0.0)) - terrainPoint(faceBasis, f - vec2(e, 0.0));
+        vec3 dv = terrainPoint(faceBasis, f + vec2(0.0, e)) - terrainPoint(faceBasis, f - vec2(0.0, e));
+        normal = normalize(cross(du, dv));
+}
+#endif
+
+#ifdef ORBITAL
+// rotation matrices matching glm::rotate around the X, Y and Z axes
+mat3 rotX(float a) { float c = cos(a), s = sin(a); return mat3(1, 0, 0, 0, c, s, 0, -s, c); }
+mat3 rotY(float a) { float c = cos(a), s = sin(a); return mat3(c, 0, -s, 0, 1, 0, s, 0, c); }
+mat3 rotZ(float a) { float c = cos(a), s = sin(a); return mat3(c, s, 0, -s, c, 0, 0, 0, 1); }
+
+// same chain as the bodies in main(): orbit rotate, orbit translate, pole up, tilt, spin, scale
+mat4 orbitalModelMatrix() {
+        float orbitAngle = iOrbit.y + time * iOrbit.z;
+        float spinAngle = time * iOrbit.w;
+        mat3 orbit = rotY(orbitAngle);
+        mat3 r = orbit * rotX(-1.5707963) * rotY(iBody.x) * rotZ(spinAngle) * iBody.y;
+        vec3 t = orbit * vec3(iOrbit.x, 0.0, 0.0);
+        return mat4(vec4(r[0], 0.0), vec4(r[1], 0.0), vec4(r[2], 0.0), vec4(t, 1.0));
+}
+#endif
 
 void main() {
-        gl_Position = projMat * viewMat * modelMat * vec4(vPosition, 1.0); // mandatory to rasterize properly
-        fPosition = vec3(modelMat * vec4(vPosition, 1.0));
-        fNormal = mat3(transpose(inverse(modelMat))) * vNormal;
-        fTexCoord = vTexCoord;
+#ifdef PROCEDURAL_SPHERE
+        vec3 position, normal;
+        vec2 texCoord;
+        proceduralSphereVertex(position, normal, texCoord);
+#elif defined(TERRAIN)
+        vec3 position, normal;
+        vec2 texCoord = vec2(0.0);
+        terrainVertex(position, normal);
+        fSphereDir = position;
+#else
+        vec3 position = posOffset + posScale * vPosition;
+        vec3 normal = octScale > 0.0 ? octDecode(clamp(vNormal.xy * octScale, -1.0, 1.0)) : vNormal;
+        vec2 texCoord = uvOffset + uvScale * vTexCoord;
+#endif
+#if defined(INSTANCED)
+        mat4 modelMat = iModelMat;
+        fLColor = iLColor;
+        fEmission = iEmission;
+        fAlbedoLayer = iAlbedoLayer;
+#else
+        fLColor = lColor;
+        fEmission = emission;
+        fAlbedoLayer = albedoLayer;
+#endif
+#if defined(ORBITAL)
+        mat4 modelMat = orbitalModelMatrix();
+#endif
+#if defined(INSTANCED) || defined(ORBITAL)
+        fPickId = pickId + uint(gl_InstanceID);
+#else
+        fPickId = pickId;
+#endif
+        gl_Position = projMat * viewMat * modelMat * vec4(position, 1.0); // mandatory to rasterize properly
+        fPosition = vec3(modelMat * vec4(position, 1.0));
+        //fPosition = vPosition;
+        fNormal = mat3(transpose(inverse(modelMat))) * normal;
+        //fNormal = vNormal;
+        fTexCoord = texCoord;
 }
 
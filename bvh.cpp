@@ -0,0 +1,266 @@
+#include "bvh.h"
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+const uint32_t kLeafSize = 4;  // bodies per leaf at most
+const uint32_t kNoParent = ~0u;
+const int kStackSize = 64;     // traversal stack; median splits keep the depth near log2(n / kLeafSize)
+
+Aabb sphereBox(const BoundingSphere &sphere)
+{
+    Aabb box;
+    if (sphere.radius >= 0)
+    {
+        box.min = sphere.center - sphere.radius;
+        box.max = sphere.center + sphere.radius;
+    }
+    return box;
+}
+
+Aabb merge(const Aabb &a, const Aabb &b)
+{
+    Aabb box;
+    box.min = glm::min(a.min, b.min);
+    box.max = glm::max(a.max, b.max);
+    return box;
+}
+
+// Nodes of the subtree over n bodies: the median splits make it depend on n only, which lets every
+// subtree know its range of nodes in advance and be built by its own thread. At depth k, the 2^k subtrees
+// hold n / 2^k bodies or one more; they all split while that is above kLeafSize.
+uint32_t subtreeNodes(const uint32_t n)
+{
+    uint32_t nodes = 0;
+    for (uint64_t parts = 1;; parts *= 2)
+    {
+        const uint32_t q = n / parts, larger = n % parts; // 'larger' subtrees have q + 1 bodies
+        nodes += parts;
+        if (q > kLeafSize)
+            continue;
+        if (q == kLeafSize)
+            nodes += 2 * larger; // only the subtrees of q + 1 bodies split, into two leaves
+        return nodes;
+    }
+}
+} // namespace
+
+void Bvh::build(const std::vector<BoundingSphere> &bodies, size_t threadCount)
+{
+    m_bodies = bodies;
+    const uint32_t n = bodies.size();
+    m_items.resize(n);
+    for (uint32_t i = 0; i < n; ++i)
+        m_items[i] = i;
+    m_nodes.resize(n > 0 ? subtreeNodes(n) : 0);
+    m_parents.assign(m_nodes.size(), kNoParent);
+    m_leafOf.resize(n);
+    m_dirty.assign(m_nodes.size(), 0);
+    m_anyDirty = false;
+    if (n == 0)
+        return;
+
+    // the 2^parallelDepth subtrees below that depth are built concurrently
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    int parallelDepth = 0;
+    while ((1u << parallelDepth) < threadCount && (n >> parallelDepth) > 4096)
+        ++parallelDepth;
+    buildNode(0, 0, n, parallelDepth);
+}
+
+void Bvh::buildNode(const uint32_t node, const uint32_t begin, const uint32_t end, const int parallelDepth)
+{
+    const uint32_t count = end - begin;
+    if (count <= kLeafSize)
+    {
+        m_nodes[node].first = begin;
+        m_nodes[node].count = count;
+        for (uint32_t i = begin; i < end; ++i)
+            m_leafOf[m_items[i]] = node;
+        m_nodes[node].box = leafBox(m_nodes[node]);
+        return;
+    }
+
+    // median split along the widest axis of the centers
+    Aabb centers;
+    for (uint32_t i = begin; i < end; ++i)
+        centers.extend(m_bodies[m_items[i]].center);
+    const glm::vec3 extent = centers.max - centers.min;
+    const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    const uint32_t middle = begin + count / 2;
+    std::nth_element(m_items.begin() + begin, m_items.begin() + middle, m_items.begin() + end,
+                     [this, axis](const uint32_t a, const uint32_t b) { return m_bodies[a].center[axis] < m_bodies[b].center[axis]; });
+
+    const uint32_t left = node + 1;
+    const uint32_t right = left + subtreeNodes(count / 2);
+    m_nodes[node].first = right;
+    m_nodes[node].count = 0;
+    m_parents[left] = node;
+    m_parents[right] = node;
+    if (parallelDepth > 0)
+    {
+        std::thread leftThread(&Bvh::buildNode, this, left, begin, middle, parallelDepth - 1);
+        buildNode(right, middle, end, parallelDepth - 1);
+        leftThread.join();
+    }
+    else
+    {
+        buildNode(left, begin, middle, 0);
+        buildNode(right, middle, end, 0);
+    }
+    m_nodes[node].box = merge(m_nodes[left].box, m_nodes[right].box);
+}
+
+Aabb Bvh::leafBox(const Node &leaf) const
+{
+    Aabb box;
+    for (uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i)
+        box = merge(box, sphereBox(m_bodies[m_items[i]]));
+    return box;
+}
+
+void Bvh::update(const uint32_t body, const BoundingSphere &sphere)
+{
+    m_bodies[body] = sphere;
+    // mark the path to the root, stopping where an earlier update already did
+    for (uint32_t node = m_leafOf[body]; node != kNoParent && !m_dirty[node]; node = m_parents[node])
+        m_dirty[node] = 1;
+    m_anyDirty = true;
+}
+
+void Bvh::refit()
+{
+    if (!m_anyDirty)
+        return;
+    // children always come after their parent: a backward pass sees them first
+    for (size_t i = m_nodes.size(); i-- > 0;)
+    {
+        if (!m_dirty[i])
+            continue;
+        Node &node = m_nodes[i];
+        node.box = node.count > 0 ? leafBox(node) : merge(m_nodes[i + 1].box, m_nodes[node.first].box);
+        m_dirty[i] = 0;
+    }
+    m_anyDirty = false;
+}
+
+void Bvh::queryFrustum(const Frustum &frustum, std::vector<uint32_t> &out) const
+{
+    if (m_nodes.empty())
+        return;
+    // nodes pushed with kInside set lie wholly in the frustum: their subtree needs no more plane tests
+    const uint32_t kInside = 1u << 31;
+    uint32_t stack[kStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        uint32_t index = stack[--top];
+        bool inside = (index & kInside) != 0;
+        index &= ~kInside;
+        const Node &node = m_nodes[index];
+        if (!inside)
+        {
+            if (!frustum.intersects(node.box))
+                continue;
+            inside = frustum.contains(node.box);
+        }
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                const BoundingSphere &body = m_bodies[m_items[i]];
+                if (inside ? body.radius >= 0 : frustum.intersects(body))
+                    out.push_back(m_items[i]);
+            }
+            continue;
+        }
+        const uint32_t flag = inside ? kInside : 0;
+        stack[top++] = node.first | flag;
+        stack[top++] = (index + 1) | flag;
+    }
+}
+
+void Bvh::querySphere(const BoundingSphere &sphere, std::vector<uint32_t> &out) const
+{
+    if (m_nodes.empty())
+        return;
+    uint32_t stack[kStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node &node = m_nodes[stack[--top]];
+        if (!intersects(sphere, node.box))
+            continue;
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                const BoundingSphere &body = m_bodies[m_items[i]];
+                const float reach = sphere.radius + body.radius;
+                if (body.radius >= 0 && glm::dot(body.center - sphere.center, body.center - sphere.center) <= reach * reach)
+                    out.push_back(m_items[i]);
+            }
+            continue;
+        }
+        stack[top++] = node.first;
+        stack[top++] = &node - m_nodes.data() + 1;
+    }
+}
+
+int Bvh::raycast(const glm::vec3 &origin, const glm::vec3 &direction, float &t) const
+{
+    int hit = -1;
+    float best = 1e30f;
+    if (m_nodes.empty())
+        return hit;
+    const glm::vec3 invDirection = 1.0f / direction;
+    uint32_t stack[kStackSize];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const Node &node = m_nodes[stack[--top]];
+        float enter;
+        if (!intersectRay(node.box, origin, invDirection, best, enter))
+            continue;
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                float distance;
+                if (intersectRay(m_bodies[m_items[i]], origin, direction, distance) && distance < best)
+                {
+                    best = distance;
+                    hit = m_items[i];
+                }
+            }
+            continue;
+        }
+        // visit the nearer child first so that the farther one is often pruned by the best hit
+        const uint32_t left = &node - m_nodes.data() + 1, right = node.first;
+        float leftEnter, rightEnter;
+        const bool leftHit = intersectRay(m_nodes[left].box, origin, invDirection, best, leftEnter);
+        const bool rightHit = intersectRay(m_nodes[right].box, origin, invDirection, best, rightEnter);
+        if (leftHit && rightHit)
+        {
+            stack[top++] = leftEnter < rightEnter ? right : left;
+            stack[top++] = leftEnter < rightEnter ? left : right;
+        }
+        else if (leftHit)
+            stack[top++] = left;
+        else if (rightHit)
+            stack[top++] = right;
+    }
+    t = best;
+    return hit;
+}
+
+size_t Bvh::size() const { return m_bodies.size(); }
+
+size_t Bvh::nodeCount() const { return m_nodes.size(); }
+
+const BoundingSphere &Bvh::body(const uint32_t index) const { return m_bodies[index]; }
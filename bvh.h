@@ -0,0 +1,56 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "bounds.h"
+
+// Bounding volume hierarchy over the bounding spheres of many bodies, for culling and proximity queries
+// in O(log n) instead of a linear scan. Built top-down with median splits on the widest axis; the two halves
+// of the top levels are built on their own threads. Moving bodies are handled by refitting the boxes without
+// changing the tree; rebuild when the bodies have moved far from where the tree was built.
+class Bvh
+{
+public:
+  // Builds the tree over bodies[0..n), body i keeping its index in the query results (0 threads: one per core)
+  void build(const std::vector<BoundingSphere> &bodies, const size_t threadCount = 0);
+  // New sphere of a body; the tree boxes only follow at the next refit()
+  void update(const uint32_t body, const BoundingSphere &sphere);
+  // Grows or shrinks the boxes above the bodies updated since the last refit, bottom-up
+  void refit();
+
+  // Bodies whose sphere may be in the frustum, appended to out
+  void queryFrustum(const Frustum &frustum, std::vector<uint32_t> &out) const;
+  // Bodies whose sphere overlaps the given one, appended to out
+  void querySphere(const BoundingSphere &sphere, std::vector<uint32_t> &out) const;
+  // Closest body hit by the ray (normalized direction) and its distance t, -1 if none
+  int raycast(const glm::vec3 &origin, const glm::vec3 &direction, float &t) const;
+
+  size_t size() const;      // number of bodies
+  size_t nodeCount() const;
+  const BoundingSphere &body(const uint32_t index) const;
+
+private:
+  // Leaves hold count > 0 bodies from m_items[first]; inner nodes have count 0 and their children at
+  // index + 1 (left) and first (right), so that a subtree is a contiguous range of nodes
+  struct Node
+  {
+    Aabb box;
+    uint32_t first;
+    uint32_t count;
+  };
+
+  void buildNode(const uint32_t node, const uint32_t begin, const uint32_t end, const int parallelDepth);
+  Aabb leafBox(const Node &leaf) const;
+
+  std::vector<BoundingSphere> m_bodies;
+  std::vector<uint32_t> m_items;   // body indices, grouped by leaf
+  std::vector<Node> m_nodes;
+  std::vector<uint32_t> m_parents; // of each node, ~0u for the root
+  std::vector<uint32_t> m_leafOf;  // leaf holding each body
+  std::vector<uint8_t> m_dirty;    // nodes whose box must be recomputed by refit()
+  bool m_anyDirty = false;
+};
+
+#endif // BVH_H
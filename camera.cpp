@@ -14,10 +14,10 @@ float Camera::getFar() const { return m_far; }
 void Camera::setFar(const float n) { m_far = n; }
 void Camera::setPosition(const glm::vec3 &p) { m_pos = p; }
 void Camera::setFront(const glm::vec3 &f) { cameraFront = f; }
-glm::vec3 Camera::getFront() { return cameraFront; }
-glm::vec3 Camera::getPosition() { return m_pos; }
+glm::vec3 Camera::getFront() const { return cameraFront; }
+glm::vec3 Camera::getPosition() const { return m_pos; }
 void Camera::setUp(const glm::vec3 &u) { cameraUp = u; }
-glm::vec3 Camera::getUp() { return cameraUp; }
+glm::vec3 Camera::getUp() const { return cameraUp; }
 
 glm::mat4 Camera::computeViewMatrix() const
 {
@@ -29,4 +29,18 @@ glm::mat4 Camera::computeViewMatrix() const
 glm::mat4 Camera::computeProjectionMatrix() const
 {
     return glm::perspective(glm::radians(m_fov), m_aspectRatio, m_near, m_far);
-}
\ No newline at end of file
+}
+
+Frustum Camera::computeFrustum() const
+{
+    return Frustum::fromMatrix(computeProjectionMatrix() * computeViewMatrix());
+}
+
+void Camera::computeRay(const glm::vec2 &ndc, glm::vec3 &origin, glm::vec3 &direction) const
+{
+    const glm::mat4 inverse = glm::inverse(computeProjectionMatrix() * computeViewMatrix());
+    const glm::vec4 nearPoint = inverse * glm::vec4(ndc, -1.0f, 1.0f);
+    const glm::vec4 farPoint = inverse * glm::vec4(ndc, 1.0f, 1.0f);
+    origin = glm::vec3(nearPoint) / nearPoint.w;
+    direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+}
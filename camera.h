@@ -5,6 +5,7 @@
 #include <memory>
 #include <glm/glm.hpp>
 #include <glad/gl.h>
+#include "bounds.h"
 // Basic camera model
 class Camera
 {
@@ -18,17 +19,24 @@ public:
     float getFar() const;
     void setFar(const float n);
     void setPosition(const glm::vec3 &p);
-    glm::vec3 getPosition();
+    glm::vec3 getPosition() const;
     void setFront(const glm::vec3 &f);
-    glm::vec3 getFront();
+    glm::vec3 getFront() const;
     void setUp(const glm::vec3 &u);
-    glm::vec3 getUp();
+    glm::vec3 getUp() const;
 
     glm::mat4 computeViewMatrix() const;
 
     // Returns the projection matrix stemming from the camera intrinsic parameter.
     glm::mat4 computeProjectionMatrix() const;
 
+    // View frustum in world space
+    Frustum computeFrustum() const;
+
+    // World space ray through a point of the image given in normalized device coordinates ([-1, 1]^2, y up),
+    // unprojected through the view and projection matrices; direction is normalized
+    void computeRay(const glm::vec2 &ndc, glm::vec3 &origin, glm::vec3 &direction) const;
+
 private:
     glm::vec3 m_pos = glm::vec3(0, 0, 0);
     glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
@@ -0,0 +1,15 @@
+#include "glstate.h"
+#include "material.h"
+#include "mesh.h"
+#include "orbit.h"
+#include "terrain.h"
+
+// GPU state and programs the scene code (mesh.cpp, orbit.cpp, terrain.cpp) draws with, shared by the application
+// and the tools; the programs stay empty until the application compiles them
+GLStateCache g_glState; // first: the objects below forget themselves in it when destroyed
+MaterialLibrary g_materials;
+SceneProgram g_program; // A GPU program contains at least a vertex shader and a fragment shader
+SceneProgram g_instancedProgram;  // Same shaders compiled with INSTANCED, for Mesh::renderInstanced()
+SceneProgram g_orbitalProgram;    // Same shaders compiled with ORBITAL, for OrbitalBelt
+SceneProgram g_proceduralProgram; // Same shaders compiled with PROCEDURAL_SPHERE, for Mesh::genProceduralSphere()
+SceneProgram g_terrainProgram;    // Same shaders compiled with TERRAIN, for PlanetTerrain
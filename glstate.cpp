@@ -0,0 +1,122 @@
+#include "glstate.h"
+
+namespace
+{
+// Index of a tracked texture target, -1 for the others
+int targetIndex(const GLenum target)
+{
+    switch (target)
+    {
+    case GL_TEXTURE_2D:
+        return 0;
+    case GL_TEXTURE_2D_ARRAY:
+        return 1;
+    default:
+        return -1;
+    }
+}
+} // namespace
+
+size_t GLCallStats::totalIssued() const
+{
+    size_t total = 0;
+    for (const size_t n : issued)
+        total += n;
+    return total;
+}
+
+size_t GLCallStats::totalSkipped() const
+{
+    size_t total = 0;
+    for (const size_t n : skipped)
+        total += n;
+    return total;
+}
+
+std::ostream &operator<<(std::ostream &out, const GLCallStats &stats)
+{
+    const char *names[(int)GLCall::Count] = {"glUseProgram", "glActiveTexture", "glBindTexture", "glBindVertexArray"};
+    for (int call = 0; call < (int)GLCall::Count; ++call)
+        out << names[call] << ": " << stats.issued[call] << " issued, " << stats.skipped[call] << " skipped\n";
+    return out;
+}
+
+GLStateCache::GLStateCache()
+{
+    invalidate();
+}
+
+bool GLStateCache::change(const GLCall call, GLuint &current, const GLuint value)
+{
+    if (current == value)
+    {
+        ++m_frame.skipped[(int)call];
+        return false;
+    }
+    ++m_frame.issued[(int)call];
+    current = value;
+    return true;
+}
+
+void GLStateCache::useProgram(const GLuint program)
+{
+    if (change(GLCall::UseProgram, m_program, program))
+        glUseProgram(program);
+}
+
+void GLStateCache::bindTexture(const GLuint unit, const GLenum target, const GLuint texture)
+{
+    const int index = targetIndex(target);
+    GLuint untracked = kUnknown;
+    GLuint &current = unit < kTextureUnits && index >= 0 ? m_textures[unit][index] : untracked;
+    if (!change(GLCall::BindTexture, current, texture))
+        return;
+    if (change(GLCall::ActiveTexture, m_activeUnit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::bindVertexArray(const GLuint vao)
+{
+    if (change(GLCall::BindVertexArray, m_vao, vao))
+        glBindVertexArray(vao);
+}
+
+void GLStateCache::forgetProgram(const GLuint program)
+{
+    // a deleted program stays in use until another one is: only its name is no longer known
+    if (m_program == program)
+        m_program = kUnknown;
+}
+
+void GLStateCache::forgetTexture(const GLuint texture)
+{
+    for (GLuint unit = 0; unit < kTextureUnits; ++unit)
+        for (int target = 0; target < kTargetCount; ++target)
+            if (m_textures[unit][target] == texture)
+                m_textures[unit][target] = 0;
+}
+
+void GLStateCache::forgetVertexArray(const GLuint vao)
+{
+    if (m_vao == vao)
+        m_vao = 0;
+}
+
+void GLStateCache::invalidate()
+{
+    m_program = kUnknown;
+    m_activeUnit = kUnknown;
+    for (GLuint unit = 0; unit < kTextureUnits; ++unit)
+        for (int target = 0; target < kTargetCount; ++target)
+            m_textures[unit][target] = kUnknown;
+    m_vao = kUnknown;
+}
+
+void GLStateCache::endFrame()
+{
+    m_lastFrame = m_frame;
+    m_frame = GLCallStats();
+}
+
+const GLCallStats &GLStateCache::lastFrame() const { return m_lastFrame; }
@@ -0,0 +1,73 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <cstddef>
+#include <ostream>
+#include <glad/gl.h>
+
+// The GL calls GLStateCache filters
+enum class GLCall
+{
+  UseProgram,
+  ActiveTexture,
+  BindTexture,
+  BindVertexArray,
+  Count
+};
+
+// Calls made to GL and calls dropped because they would not have changed the state, per GLCall
+struct GLCallStats
+{
+  size_t issued[(int)GLCall::Count] = {};
+  size_t skipped[(int)GLCall::Count] = {};
+
+  size_t totalIssued() const;
+  size_t totalSkipped() const;
+};
+
+// One line per call: issued and skipped
+std::ostream &operator<<(std::ostream &out, const GLCallStats &stats);
+
+// Shadow of the program, texture and vertex array bindings of the context: binds that match it are not sent to GL.
+// Every glUseProgram, glActiveTexture, glBindTexture and glBindVertexArray must go through it, and objects must be
+// forgotten before they are deleted (GL unbinds them and may reuse their names); after GL calls made behind its
+// back, invalidate() it.
+class GLStateCache
+{
+public:
+  GLStateCache();
+
+  void useProgram(const GLuint program);
+  // unit: index of the texture unit, e.g., 0 for GL_TEXTURE0; selects it only when the binding changes
+  void bindTexture(const GLuint unit, const GLenum target, const GLuint texture);
+  void bindVertexArray(const GLuint vao);
+
+  void forgetProgram(const GLuint program);
+  void forgetTexture(const GLuint texture);
+  void forgetVertexArray(const GLuint vao);
+  // The next binds are sent whatever they are
+  void invalidate();
+
+  // Ends the frame: its counts become lastFrame() and the counting restarts
+  void endFrame();
+  const GLCallStats &lastFrame() const;
+
+private:
+  static const GLuint kTextureUnits = 8;  // tracked units, binds on the others always go to GL
+  static const int kTargetCount = 2;      // GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY
+  static const GLuint kUnknown = ~0u;     // a binding that must be sent
+
+  // Counts the call and tells whether to make it, updating the shadow
+  bool change(const GLCall call, GLuint &current, const GLuint value);
+
+  GLuint m_program;
+  GLuint m_activeUnit;
+  GLuint m_textures[kTextureUnits][kTargetCount];
+  GLuint m_vao;
+  GLCallStats m_frame;
+  GLCallStats m_lastFrame;
+};
+
+extern GLStateCache g_glState;
+
+#endif // GLSTATE_H
@@ -0,0 +1,283 @@
+#include "gltf.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include "json.h"
+#include "mappedfile.h"
+
+namespace
+{
+const uint32_t kGlbMagic = 0x46546C67; // "glTF"
+const uint32_t kChunkJson = 0x4E4F534A;
+const uint32_t kChunkBin = 0x004E4942;
+
+uint32_t readU32(const unsigned char *p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v)); // glb is little-endian, like every platform we target
+    return v;
+}
+
+GLint componentCount(const std::string &type)
+{
+    if (type == "SCALAR")
+        return 1;
+    if (type == "VEC2")
+        return 2;
+    if (type == "VEC3")
+        return 3;
+    if (type == "VEC4")
+        return 4;
+    return 0; // matrices are not vertex attributes we read
+}
+
+// Bytes of a glTF component type, 0 for an unknown one
+size_t componentSize(const GLenum componentType)
+{
+    switch (componentType)
+    {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+        return 2;
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+const JsonValue *arrayItem(const JsonValue *array, const double index)
+{
+    if (!array || array->type != JsonValue::Array || index < 0 || (size_t)index >= array->array.size())
+        return nullptr;
+    return &array->array[(size_t)index];
+}
+
+// Accessor resolved down to a GPU buffer (glTF component types and modes are GL enums already)
+struct ResolvedAccessor
+{
+    GLuint buffer = 0;
+    size_t offset = 0;
+    GLsizei stride = 0;
+    GLenum componentType = 0;
+    GLint components = 0;
+    GLboolean normalized = GL_FALSE;
+    GLsizei count = 0;
+    const JsonValue *json = nullptr;
+};
+} // namespace
+
+std::shared_ptr<GlbModel> GlbModel::load(const std::string &filename)
+{
+    const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    MappedFile file(filename);
+    if (!file.isOpen() || file.size() < 20)
+    {
+        std::cerr << "ERROR: cannot open " << filename << std::endl;
+        return nullptr;
+    }
+    const unsigned char *data = file.data();
+    if (readU32(data) != kGlbMagic || readU32(data + 4) != 2 || readU32(data + 8) > file.size())
+    {
+        std::cerr << "ERROR: " << filename << " is not a glTF 2.0 binary file" << std::endl;
+        return nullptr;
+    }
+
+    // chunks: the JSON header, then the optional binary buffer
+    const size_t length = readU32(data + 8);
+    const char *jsonBegin = nullptr, *jsonEnd = nullptr;
+    const unsigned char *bin = nullptr;
+    size_t binSize = 0;
+    for (size_t offset = 12; offset + 8 <= length;)
+    {
+        const size_t chunkSize = readU32(data + offset);
+        const uint32_t chunkType = readU32(data + offset + 4);
+        const unsigned char *chunk = data + offset + 8;
+        if (offset + 8 + chunkSize > length)
+            break;
+        if (chunkType == kChunkJson && !jsonBegin)
+        {
+            jsonBegin = (const char *)chunk;
+            jsonEnd = jsonBegin + chunkSize;
+        }
+        else if (chunkType == kChunkBin && !bin)
+        {
+            bin = chunk;
+            binSize = chunkSize;
+        }
+        offset += 8 + ((chunkSize + 3) & ~size_t(3));
+    }
+    JsonValue gltf;
+    std::string error;
+    if (!jsonBegin || !JsonValue::parse(jsonBegin, jsonEnd, gltf, error))
+    {
+        std::cerr << "ERROR: invalid glTF header in " << filename << ": " << error << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<GlbModel> model(new GlbModel());
+    model->m_fileBytes = file.size();
+    const JsonValue *accessors = gltf.find("accessors");
+    const JsonValue *bufferViews = gltf.find("bufferViews");
+    const JsonValue *buffers = gltf.find("buffers");
+    std::map<size_t, GLuint> uploadedViews;
+
+    // GPU buffer of a buffer view, uploaded straight from the mapping on first use; the view must lie in the
+    // binary chunk, which lies in the mapped file (checked with the chunks)
+    auto viewBuffer = [&](const size_t viewIndex, const JsonValue *view) -> GLuint {
+        const JsonValue *buffer = arrayItem(buffers, view->numberOr("buffer", -1));
+        if (!buffer || buffer->find("uri") || !bin)
+            return 0; // only the embedded binary chunk is supported
+        const double byteOffset = view->numberOr("byteOffset", 0);
+        const double byteLength = view->numberOr("byteLength", 0);
+        if (byteOffset < 0 || byteLength <= 0 || byteOffset + byteLength > binSize)
+        {
+            std::cerr << "ERROR: " << filename << ": buffer view " << viewIndex << " is out of the binary chunk" << std::endl;
+            return 0;
+        }
+        std::map<size_t, GLuint>::iterator it = uploadedViews.find(viewIndex);
+        if (it != uploadedViews.end())
+            return it->second;
+        GLuint id = 0;
+        glGenBuffers(1, &id);
+        glBindBuffer(GL_ARRAY_BUFFER, id); // usable as an index buffer later on desktop GL
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)byteLength, bin + (size_t)byteOffset, GL_STATIC_DRAW);
+        model->m_buffers.push_back(id);
+        model->m_uploadedBytes += (size_t)byteLength;
+        uploadedViews[viewIndex] = id;
+        return id;
+    };
+
+    auto resolve = [&](const double accessorIndex, ResolvedAccessor &out) -> bool {
+        const JsonValue *accessor = arrayItem(accessors, accessorIndex);
+        if (!accessor || accessor->find("sparse"))
+            return false;
+        const double viewIndex = accessor->numberOr("bufferView", -1);
+        const JsonValue *view = arrayItem(bufferViews, viewIndex);
+        if (!view)
+            return false;
+        const JsonValue *type = accessor->find("type");
+        const JsonValue *normalized = accessor->find("normalized");
+        const double offset = accessor->numberOr("byteOffset", 0);
+        const double stride = view->numberOr("byteStride", 0);
+        const double count = accessor->numberOr("count", 0);
+        out.componentType = (GLenum)accessor->numberOr("componentType", 0);
+        out.components = type ? componentCount(type->string) : 0;
+        out.normalized = normalized && normalized->boolean ? GL_TRUE : GL_FALSE;
+        out.json = accessor;
+
+        // the last element must end inside the view: GL would read past it, into another view or the heap
+        const size_t elementSize = componentSize(out.componentType) * out.components;
+        const double step = stride > 0 ? stride : elementSize;
+        if (elementSize == 0 || offset < 0 || stride < 0 || stride > 255 || count < 1 ||
+            offset + (count - 1) * step + elementSize > view->numberOr("byteLength", 0))
+        {
+            std::cerr << "ERROR: " << filename << ": accessor " << accessorIndex << " is out of its buffer view" << std::endl;
+            return false;
+        }
+        out.offset = (size_t)offset;
+        out.stride = (GLsizei)stride;
+        out.count = (GLsizei)count;
+        out.buffer = viewBuffer((size_t)viewIndex, view);
+        return out.buffer != 0;
+    };
+
+    bool firstBounds = true;
+    const JsonValue *meshes = gltf.find("meshes");
+    for (size_t m = 0; meshes && m < meshes->array.size(); ++m)
+    {
+        const JsonValue *primitives = meshes->array[m].find("primitives");
+        for (size_t p = 0; primitives && p < primitives->array.size(); ++p)
+        {
+            const JsonValue &primitive = primitives->array[p];
+            const JsonValue *attributes = primitive.find("attributes");
+            if (!attributes)
+                continue;
+            const char *names[3] = {"POSITION", "NORMAL", "TEXCOORD_0"}; // locations 0, 1, 2 of the shaders
+            VertexAttribute layout[3] = {};
+            GLsizei vertexCount = 0;
+            ResolvedAccessor position;
+            for (int a = 0; a < 3; ++a)
+            {
+                ResolvedAccessor accessor;
+                // every attribute needs a value per vertex: a shorter one would be read past its end
+                if (!resolve(attributes->numberOr(names[a], -1), accessor) || (a > 0 && accessor.count < vertexCount))
+                    continue;
+                layout[a] = VertexAttribute{accessor.buffer, accessor.components, accessor.componentType,
+                                            accessor.normalized, accessor.stride, accessor.offset};
+                if (a == 0)
+                {
+                    position = accessor;
+                    vertexCount = accessor.count;
+                }
+            }
+            if (layout[0].buffer == 0)
+            {
+                std::cerr << "WARNING: " << filename << ": primitive without usable POSITION skipped" << std::endl;
+                continue;
+            }
+            // the vertices stay in GPU buffers, where no normal can be computed from them; the lighting needs one
+            if (layout[1].buffer == 0)
+            {
+                std::cerr << "WARNING: " << filename << ": primitive without usable NORMAL skipped" << std::endl;
+                continue;
+            }
+
+            ResolvedAccessor indices;
+            const bool indexed = primitive.find("indices") != nullptr;
+            if (indexed && !resolve(primitive.numberOr("indices", -1), indices))
+                continue;
+            // POSITION accessors must carry their min and max: bounds without reading the vertices
+            Aabb bounds;
+            const JsonValue *lo = position.json->find("min");
+            const JsonValue *hi = position.json->find("max");
+            if (lo && hi && lo->array.size() == 3 && hi->array.size() == 3)
+            {
+                bounds.min = glm::vec3(lo->array[0].number, lo->array[1].number, lo->array[2].number);
+                bounds.max = glm::vec3(hi->array[0].number, hi->array[1].number, hi->array[2].number);
+                model->m_boundsMin = firstBounds ? bounds.min : glm::min(model->m_boundsMin, bounds.min);
+                model->m_boundsMax = firstBounds ? bounds.max : glm::max(model->m_boundsMax, bounds.max);
+                firstBounds = false;
+            }
+
+            const GLenum mode = (GLenum)primitive.numberOr("mode", GL_TRIANGLES);
+            model->m_meshes.push_back(Mesh::fromBuffers(layout, vertexCount, indexed ? indices.buffer : 0,
+                                                        indices.componentType, indices.count, indices.offset, mode, bounds));
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    model->m_loadSeconds = elapsed.count();
+    const double megabytes = model->m_fileBytes / (1024.0 * 1024.0);
+    std::cout << "Loaded " << filename << ": " << model->m_meshes.size() << " primitives, "
+              << megabytes << " MB in " << model->m_loadSeconds * 1e3 << " ms ("
+              << megabytes / std::max(model->m_loadSeconds, 1e-9) << " MB/s)" << std::endl;
+    return model;
+}
+
+GlbModel::~GlbModel()
+{
+    m_meshes.clear();
+    if (!m_buffers.empty())
+        glDeleteBuffers(m_buffers.size(), m_buffers.data());
+}
+
+const std::vector<std::shared_ptr<Mesh>> &GlbModel::meshes() const { return m_meshes; }
+
+glm::vec3 GlbModel::boundsMin() const { return m_boundsMin; }
+
+glm::vec3 GlbModel::boundsMax() const { return m_boundsMax; }
+
+size_t GlbModel::fileBytes() const { return m_fileBytes; }
+
+size_t GlbModel::uploadedBytes() const { return m_uploadedBytes; }
+
+double GlbModel::loadSeconds() const { return m_loadSeconds; }
@@ -0,0 +1,45 @@
+#ifndef GLTF_H
+#define GLTF_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include <glad/gl.h>
+#include "mesh.h"
+
+// Meshes of a binary glTF 2.0 file (.glb). The file is memory-mapped and the binary buffer views used by
+// the meshes are handed to glBufferData as they are: no parsing nor copy of the vertex and index data.
+// Each primitive becomes a Mesh reading POSITION, NORMAL and TEXCOORD_0 with the layout and index type of
+// the file. Node transforms, materials, textures, sparse accessors and external buffers are ignored.
+class GlbModel
+{
+public:
+  ~GlbModel();
+  GlbModel(const GlbModel &) = delete;
+  GlbModel &operator=(const GlbModel &) = delete;
+
+  // Loads the file and reports the load throughput; returns nullptr on error (needs a GL context)
+  static std::shared_ptr<GlbModel> load(const std::string &filename);
+
+  const std::vector<std::shared_ptr<Mesh>> &meshes() const;
+  glm::vec3 boundsMin() const; // bounding box of all the primitives, from the accessor min/max
+  glm::vec3 boundsMax() const;
+
+  size_t fileBytes() const;     // size of the .glb file
+  size_t uploadedBytes() const; // bytes handed to the GPU
+  double loadSeconds() const;   // from opening the file to the last upload
+
+private:
+  GlbModel() = default;
+
+  std::vector<std::shared_ptr<Mesh>> m_meshes;
+  std::vector<GLuint> m_buffers; // one per uploaded buffer view, shared by the meshes
+  glm::vec3 m_boundsMin = glm::vec3(0.0f);
+  glm::vec3 m_boundsMax = glm::vec3(0.0f);
+  size_t m_fileBytes = 0;
+  size_t m_uploadedBytes = 0;
+  double m_loadSeconds = 0.0;
+};
+
+#endif // GLTF_H
@@ -0,0 +1,241 @@
+#include "json.h"
+#include <cstdlib>
+#include <cstring>
+
+const JsonValue *JsonValue::find(const std::string &key) const
+{
+  for (size_t i = 0; i < object.size(); ++i)
+    if (object[i].first == key)
+      return &object[i].second;
+  return nullptr;
+}
+
+double JsonValue::numberOr(const std::string &key, const double fallback) const
+{
+  const JsonValue *value = find(key);
+  return value && value->type == Number ? value->number : fallback;
+}
+
+namespace
+{
+// Nesting of arrays and objects past which a document is rejected: the parser recurses once per level, and a
+// header of a few kilobytes could otherwise overflow the stack
+const int kMaxDepth = 64;
+
+// Recursive descent parser over a character range
+class JsonParser
+{
+public:
+  JsonParser(const char *begin, const char *end) : m_cur(begin), m_end(end) {}
+
+  bool parseValue(JsonValue &out)
+  {
+    skipSpaces();
+    if (m_cur == m_end)
+      return fail("unexpected end of input");
+    switch (*m_cur)
+    {
+    case '{':
+    case '[':
+    {
+      if (m_depth == kMaxDepth)
+        return fail("nested too deeply");
+      ++m_depth;
+      const bool parsed = *m_cur == '{' ? parseObject(out) : parseArray(out);
+      --m_depth;
+      return parsed;
+    }
+    case '"':
+      out.type = JsonValue::String;
+      return parseString(out.string);
+    case 't':
+      out.type = JsonValue::Bool;
+      out.boolean = true;
+      return literal("true");
+    case 'f':
+      out.type = JsonValue::Bool;
+      out.boolean = false;
+      return literal("false");
+    case 'n':
+      out.type = JsonValue::Null;
+      return literal("null");
+    default:
+      return parseNumber(out);
+    }
+  }
+
+  bool atEnd()
+  {
+    skipSpaces();
+    return m_cur == m_end;
+  }
+
+  std::string error;
+
+private:
+  bool fail(const char *message)
+  {
+    error = message;
+    return false;
+  }
+
+  void skipSpaces()
+  {
+    while (m_cur != m_end && (*m_cur == ' ' || *m_cur == '\t' || *m_cur == '\n' || *m_cur == '\r'))
+      ++m_cur;
+  }
+
+  bool literal(const char *word)
+  {
+    const size_t length = std::strlen(word);
+    if ((size_t)(m_end - m_cur) < length || std::strncmp(m_cur, word, length) != 0)
+      return fail("invalid literal");
+    m_cur += length;
+    return true;
+  }
+
+  bool parseNumber(JsonValue &out)
+  {
+    const char *start = m_cur;
+    while (m_cur != m_end && (std::strchr("+-0123456789.eE", *m_cur) != nullptr))
+      ++m_cur;
+    if (start == m_cur)
+      return fail("unexpected character");
+    out.type = JsonValue::Number;
+    out.number = std::strtod(std::string(start, m_cur).c_str(), nullptr);
+    return true;
+  }
+
+  // Appends the UTF-8 encoding of a code point
+  static void appendUtf8(std::string &s, const unsigned long c)
+  {
+    if (c < 0x80)
+      s += (char)c;
+    else if (c < 0x800)
+    {
+      s += (char)(0xC0 | (c >> 6));
+      s += (char)(0x80 | (c & 0x3F));
+    }
+    else
+    {
+      s += (char)(0xE0 | (c >> 12));
+      s += (char)(0x80 | ((c >> 6) & 0x3F));
+      s += (char)(0x80 | (c & 0x3F));
+    }
+  }
+
+  bool parseString(std::string &out)
+  {
+    ++m_cur; // opening quote
+    while (m_cur != m_end && *m_cur != '"')
+    {
+      if (*m_cur != '\\')
+      {
+        out += *m_cur++;
+        continue;
+      }
+      if (++m_cur == m_end)
+        break;
+      const char c = *m_cur++;
+      switch (c)
+      {
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u':
+        if (m_end - m_cur < 4)
+          return fail("truncated unicode escape");
+        appendUtf8(out, std::strtoul(std::string(m_cur, m_cur + 4).c_str(), nullptr, 16));
+        m_cur += 4;
+        break;
+      default: out += c; break; // \" \\ \/
+      }
+    }
+    if (m_cur == m_end)
+      return fail("unterminated string");
+    ++m_cur; // closing quote
+    return true;
+  }
+
+  bool parseArray(JsonValue &out)
+  {
+    out.type = JsonValue::Array;
+    ++m_cur;
+    skipSpaces();
+    if (m_cur != m_end && *m_cur == ']')
+    {
+      ++m_cur;
+      return true;
+    }
+    while (true)
+    {
+      out.array.push_back(JsonValue());
+      if (!parseValue(out.array.back()))
+        return false;
+      skipSpaces();
+      if (m_cur == m_end)
+        return fail("unterminated array");
+      if (*m_cur++ == ']')
+        return true;
+      if (m_cur[-1] != ',')
+        return fail("expected ',' or ']'");
+    }
+  }
+
+  bool parseObject(JsonValue &out)
+  {
+    out.type = JsonValue::Object;
+    ++m_cur;
+    skipSpaces();
+    if (m_cur != m_end && *m_cur == '}')
+    {
+      ++m_cur;
+      return true;
+    }
+    while (true)
+    {
+      skipSpaces();
+      if (m_cur == m_end || *m_cur != '"')
+        return fail("expected a key");
+      out.object.push_back(std::make_pair(std::string(), JsonValue()));
+      if (!parseString(out.object.back().first))
+        return false;
+      skipSpaces();
+      if (m_cur == m_end || *m_cur++ != ':')
+        return fail("expected ':'");
+      if (!parseValue(out.object.back().second))
+        return false;
+      skipSpaces();
+      if (m_cur == m_end)
+        return fail("unterminated object");
+      if (*m_cur++ == '}')
+        return true;
+      if (m_cur[-1] != ',')
+        return fail("expected ',' or '}'");
+    }
+  }
+
+  const char *m_cur;
+  const char *m_end;
+  int m_depth = 0; // arrays and objects being parsed
+};
+} // namespace
+
+bool JsonValue::parse(const char *begin, const char *end, JsonValue &out, std::string &error)
+{
+  JsonParser parser(begin, end);
+  out = JsonValue();
+  if (!parser.parseValue(out))
+  {
+    error = parser.error;
+    return false;
+  }
+  if (!parser.atEnd())
+  {
+    error = "trailing characters";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,38 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <vector>
+#include <utility>
+
+// Minimal JSON document, enough for the glTF headers: values are parsed once into this tree
+class JsonValue
+{
+public:
+  enum Type
+  {
+    Null,
+    Bool,
+    Number,
+    String,
+    Array,
+    Object
+  };
+
+  Type type = Null;
+  bool boolean = false;
+  double number = 0;
+  std::string string;
+  std::vector<JsonValue> array;
+  std::vector<std::pair<std::string, JsonValue>> object; // in document order
+
+  // Member of an object, nullptr if absent (or if this is not an object)
+  const JsonValue *find(const std::string &key) const;
+  // Number member of an object, or fallback if absent
+  double numberOr(const std::string &key, const double fallback) const;
+
+  // Parses [begin, end); returns false and sets error on malformed input
+  static bool parse(const char *begin, const char *end, JsonValue &out, std::string &error);
+};
+
+#endif // JSON_H
@@ -0,0 +1,42 @@
+#include "lod.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/gtc/constants.hpp>
+#include "camera.h"
+
+SphereLod::SphereLod(MeshLibrary &library, const MeshGenerator generator, const std::vector<size_t> &resolutions,
+                     const float pixelsPerSegment, const float hysteresis)
+    : m_resolutions(resolutions), m_pixelsPerSegment(pixelsPerSegment), m_hysteresis(hysteresis)
+{
+    for (size_t i = 0; i < m_resolutions.size(); ++i)
+        m_meshes.push_back(library.get(MeshKey{generator, m_resolutions[i]}));
+}
+
+size_t SphereLod::selectLevel(const size_t currentLevel, const float radiusPx) const
+{
+    // resolution giving segments of m_pixelsPerSegment pixels along the projected equator
+    const float wanted = 2.0f * glm::pi<float>() * radiusPx / m_pixelsPerSegment;
+    size_t level = std::min(currentLevel, m_resolutions.size() - 1);
+    // refine while the current level is clearly too coarse, coarsen while the previous one is clearly enough
+    while (level + 1 < m_resolutions.size() && wanted > m_resolutions[level] * (1.0f + m_hysteresis))
+        ++level;
+    while (level > 0 && wanted < m_resolutions[level - 1] * (1.0f - m_hysteresis))
+        --level;
+    return level;
+}
+
+std::shared_ptr<Mesh> SphereLod::mesh(const size_t level) const { return m_meshes[level]; }
+
+size_t SphereLod::resolution(const size_t level) const { return m_resolutions[level]; }
+
+size_t SphereLod::levelCount() const { return m_resolutions.size(); }
+
+float SphereLod::projectedRadius(const Camera &camera, const glm::vec3 &center, const float radius, const float viewportHeight)
+{
+    const float distance = glm::length(center - camera.getPosition());
+    if (distance <= radius)
+        return std::numeric_limits<float>::max(); // camera inside the body
+    const float tanHalfFov = std::tan(glm::radians(camera.getFov()) * 0.5f);
+    return radius / (distance * tanHalfFov) * (viewportHeight * 0.5f);
+}
@@ -0,0 +1,37 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "meshlibrary.h"
+
+class Camera;
+
+// Chain of spheres of increasing resolution (any resolution-driven sphere generator of the library). The level of a body is picked every frame from
+// its projected radius on screen, with hysteresis so that it does not pop back and forth.
+class SphereLod
+{
+public:
+  SphereLod(MeshLibrary &library, const MeshGenerator generator = MeshGenerator::Sphere,
+            const std::vector<size_t> &resolutions = {8, 16, 32, 64, 128},
+            const float pixelsPerSegment = 8.0f, const float hysteresis = 0.2f);
+
+  // Level to use for a body of projected radius radiusPx (pixels), given the level it used at the previous frame
+  size_t selectLevel(const size_t currentLevel, const float radiusPx) const;
+  std::shared_ptr<Mesh> mesh(const size_t level) const;
+  size_t resolution(const size_t level) const;
+  size_t levelCount() const;
+
+  // Radius in pixels of the sphere (center, radius) seen by the camera, for a viewport of the given height
+  static float projectedRadius(const Camera &camera, const glm::vec3 &center, const float radius, const float viewportHeight);
+
+private:
+  std::vector<size_t> m_resolutions;
+  std::vector<std::shared_ptr<Mesh>> m_meshes;
+  float m_pixelsPerSegment; // target on-screen length of a sphere segment along the equator
+  float m_hysteresis;       // relative margin around the switching thresholds
+};
+
+#endif // LOD_H
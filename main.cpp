@@ -34,8 +34,21 @@
 #include <memory>
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <sys/stat.h>
 #include "mesh.h"
+#include "meshlibrary.h"
+#include "orbit.h"
+#include "lod.h"
 #include "camera.h"
+#include "gltf.h"
+#include "assetarchive.h"
+#include "terrain.h"
+#include "picking.h"
+#include "occlusion.h"
+#include "renderqueue.h"
+#include "glstate.h"
+#include "material.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -46,12 +59,40 @@ const static float kSizeEarth = 0.5;
 const static float kSizeMoon = 0.25;
 const static float kRadOrbitEarth = 10;
 const static float kRadOrbitMoon = 2;
+const static size_t kBeltSize = 5000; // number of rocks in the asteroid belt
+const static float kBeltInnerRadius = 4;
+const static float kBeltOuterRadius = 7;
+const static MeshGenerator kSphereGenerator = MeshGenerator::Sphere; // SphereStrip for restart strips, ProceduralSphere for no vertex memory
+const static glm::vec3 kModelPosition = glm::vec3(0, 3, 0); // where the .glb model is shown
+const static float kModelRadius = 0.5;
+const static char *kWindowTitle = "Interactive 3D Applications (OpenGL) - Simple Solar System";
+const static float kTerrainDistance = 4; // in earth radii, below which the earth is drawn as a PlanetTerrain
+const static VertexLayout kVertexLayout = VertexLayout::Interleaved; // Split to compare vertex fetch throughput, QuantizedOct8/16 to save memory
+const static RetentionPolicy kRetention = RetentionPolicy::KeepBounds; // nothing reads the CPU-side geometry after the upload
+
+// Bodies that can be picked with the mouse, followed by the rocks of the belt; the IdBuffer stores body + 1
+enum PickBody
+{
+  kPickSun,
+  kPickEarth,
+  kPickMoon,
+  kPickModel,
+  kPickBodyCount
+};
 
 float deltaTime = 0.0f; // Time between current frame and last frame
 float lastFrame = 0.0f; // Time of last frame
 
 float earthRotation, earthOrbit, moonRotation, moonOrbit;
-GLuint g_earthTexID, g_moonTexID;
+// Albedo maps of the bodies, one layer each in a single texture array
+enum AlbedoLayer
+{
+  kEarthLayer,
+  kMoonLayer,
+  kWhiteLayer // added after the files by loadTextureArrayFromFilesToGPU, for the untextured materials
+};
+GLuint g_albedoTexID;
+MaterialHandle g_sunMaterial, g_earthMaterial, g_moonMaterial, g_modelMaterial, g_rockMaterial;
 bool firstMouse;
 float lastX = 0, lastY = 0;
 float yaw = -90.0f;
@@ -62,9 +103,10 @@ glm::mat4 g_sun, g_earth, g_moon;
 
 // Window parameters
 GLFWwindow *g_window = nullptr;
+float g_viewportHeight = 768; // framebuffer height, for the screen-space level of detail
 
-// GPU objects
-GLuint g_program = 0; // A GPU program contains at least a vertex shader and a fragment shader
+// GPU objects; g_glState, g_materials and the programs are in globals.cpp
+std::shared_ptr<UniformBuffer> g_frameData = nullptr; // FrameData block of every program, filled once per frame
 
 // OpenGL identifiers
 GLuint g_vao = 0;
@@ -79,41 +121,162 @@ std::vector<unsigned int> g_triangleIndices;
 
 Camera g_camera;
 
+MeshLibrary g_meshLibrary(kVertexLayout, kRetention);
+
 std::shared_ptr<Mesh> earthptr = nullptr;
 std::shared_ptr<Mesh> moonptr = nullptr;
 std::shared_ptr<Mesh> sunptr = nullptr;
-
-GLuint loadTextureFromFileToGPU(const std::string &filename)
+std::shared_ptr<OrbitalBelt> beltptr = nullptr; // animated on the GPU, see vertexShader.glsl
+std::shared_ptr<GlbModel> g_model = nullptr;    // optional .glb given on the command line
+glm::mat4 g_modelMat = glm::mat4(1.0f);         // fits it in a sphere above the sun
+
+// Cooked shaders, textures and meshes (see tools/cook.cpp); everything is loaded from the sources without it
+const static char *kAssetArchive = "assets.pak";
+std::shared_ptr<AssetArchive> g_assets = nullptr;
+
+// Sphere levels of detail, and the level each body used at the previous frame
+std::shared_ptr<SphereLod> g_sphereLod = nullptr;
+size_t g_sunLod = 0, g_earthLod = 0, g_moonLod = 0;
+// Draws issued and skipped by the frustum culling in the last frame, shown in the window title
+struct CullStats
+{
+  size_t drawn = 0;
+  size_t culled = 0;
+};
+CullStats g_cullStats;
+float g_lastTitleTime = 0.0f;
+
+// Earth surface drawn instead of the sphere on close approaches
+std::shared_ptr<PlanetTerrain> g_earthTerrain = nullptr;
+
+// Picking with the left mouse button: ray casts through a Bvh, or with G, reads back the id under the cursor from the GPU
+std::shared_ptr<BodyPicker> g_picker = nullptr;
+std::shared_ptr<IdBuffer> g_idBuffer = nullptr;
+bool g_gpuPicking = false;
+bool g_pickRequested = false;
+double g_pickX = 0, g_pickY = 0; // cursor position of the request, in window coordinates
+std::string g_pickedName = "nothing";
+
+// Occlusion culling of the bodies hidden by nearer ones, toggled with O
+std::shared_ptr<OcclusionCuller> g_occlusion = nullptr;
+bool g_occlusionCulling = false;
+
+// Draws of the meshes, sorted to limit the state changes (or front to back for the occlusion culling)
+RenderQueue g_renderQueue;
+RenderQueueStats g_queueStats; // of the main pass, not the picking one
+
+// Pixels of an image, decoded by stb_image or cooked in the archive
+struct Image
 {
-  int width, height, numComponents;
-  // Loading the image in CPU memory using stb_image
-  unsigned char *data = stbi_load(
-      filename.c_str(),
-      &width, &height,
-      &numComponents, // 1 for a 8 bit grey-scale image, 3 for 24bits RGB image, 4 for 32bits RGBA image
-      0);
+  int width = 0, height = 0, numComponents = 0; // 1 for a 8 bit grey-scale image, 3 for 24bits RGB image, 4 for 32bits RGBA image
+  unsigned char *data = nullptr;
+  bool cooked = false; // the archive owns the pixels
+};
 
-  GLuint texID;
-  // TODO: create a texture and upload the image data in GPU memory using
-  // glGenTextures, glBindTexture, glTexParameteri, and glTexImage2D
-  glGenTextures(1, &texID);
-  glBindTexture(GL_TEXTURE_2D, texID);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  if (data)
+// Decodes the image cooked as assetName, or filename when the archive does not hold it
+Image loadImage(const std::string &filename, const std::string &assetName)
+{
+  Image image;
+  const AssetEntry *entry = g_assets ? g_assets->find(assetName) : nullptr;
+  image.cooked = entry && entry->type == AssetType::Texture;
+  if (image.cooked)
   {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    // already decoded by the cooking step: upload straight from the mapped archive
+    image.width = entry->width;
+    image.height = entry->height;
+    image.numComponents = entry->channels;
+    image.data = const_cast<unsigned char *>(g_assets->data(*entry));
   }
   else
   {
-    std::cout << "Failed to load texture" << std::endl;
+    // Loading the image in CPU memory using stb_image
+    image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.numComponents, 0);
   }
+  if (!image.data)
+    std::cout << "Failed to load texture " << filename << std::endl;
+  return image;
+}
 
-  // Free useless CPU memory
-  stbi_image_free(data);
-  glBindTexture(GL_TEXTURE_2D, 0); // unbind the texture
+// Free useless CPU memory (the archive owns its pixels)
+void freeImage(Image &image)
+{
+  if (!image.cooked)
+    stbi_image_free(image.data);
+  image.data = nullptr;
+}
+
+// RGB pixels of the image, resampled bilinearly to width x height (pixel centers aligned) if its size differs
+std::vector<unsigned char> resampleRGB(const Image &image, const int width, const int height)
+{
+  std::vector<unsigned char> rgb(3 * width * height);
+  const int n = image.numComponents;
+  // grey-scale images are replicated on the three channels
+  const int channels[3] = {0, n >= 3 ? 1 : 0, n >= 3 ? 2 : 0};
+  for (int y = 0; y < height; ++y)
+  {
+    const float sy = std::max((y + 0.5f) * image.height / height - 0.5f, 0.0f);
+    const int y0 = std::min((int)sy, image.height - 1), y1 = std::min(y0 + 1, image.height - 1);
+    const float fy = sy - y0;
+    for (int x = 0; x < width; ++x)
+    {
+      const float sx = std::max((x + 0.5f) * image.width / width - 0.5f, 0.0f);
+      const int x0 = std::min((int)sx, image.width - 1), x1 = std::min(x0 + 1, image.width - 1);
+      const float fx = sx - x0;
+      const unsigned char *p00 = image.data + n * (y0 * image.width + x0), *p10 = image.data + n * (y0 * image.width + x1);
+      const unsigned char *p01 = image.data + n * (y1 * image.width + x0), *p11 = image.data + n * (y1 * image.width + x1);
+      for (int c = 0; c < 3; ++c)
+      {
+        const int k = channels[c];
+        const float top = p00[k] + fx * (p10[k] - p00[k]), bottom = p01[k] + fx * (p11[k] - p01[k]);
+        rgb[3 * (y * width + x) + c] = (unsigned char)(top + fy * (bottom - top) + 0.5f);
+      }
+    }
+  }
+  return rgb;
+}
+
+// Uploads the textures as the layers of one GL_TEXTURE_2D_ARRAY, layer i from filenames[i] (or the
+// cooked assetNames[i]), so that bodies with different maps share a bind. The layers have the size of the first
+// image, the others are resampled to it; an image that fails to load leaves its layer black. One more layer, all
+// white, follows the files: materials without a map sample it so that their color is left as is.
+GLuint loadTextureArrayFromFilesToGPU(const std::vector<std::string> &filenames, const std::vector<std::string> &assetNames)
+{
+  std::vector<Image> images;
+  int width = 0, height = 0;
+  for (size_t i = 0; i < filenames.size(); ++i)
+  {
+    images.push_back(loadImage(filenames[i], assetNames[i]));
+    if (width == 0 && images.back().data)
+    {
+      width = images.back().width;
+      height = images.back().height;
+    }
+  }
+  width = std::max(width, 1);
+  height = std::max(height, 1);
+
+  GLuint texID;
+  glGenTextures(1, &texID);
+  g_glState.bindTexture(0, GL_TEXTURE_2D_ARRAY, texID);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, width, height, images.size() + 1, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows are tightly packed
+  for (size_t layer = 0; layer < images.size(); ++layer)
+  {
+    Image &image = images[layer];
+    // the layers all have the same format: RGB, whatever the images have
+    const std::vector<unsigned char> rgb = image.data ? resampleRGB(image, width, height)
+                                                      : std::vector<unsigned char>(3 * width * height, 0);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+    freeImage(image);
+  }
+  const std::vector<unsigned char> white(3 * width * height, 0xFF);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, images.size(), width, height, 1, GL_RGB, GL_UNSIGNED_BYTE, white.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  g_glState.bindTexture(0, GL_TEXTURE_2D_ARRAY, 0); // unbind the texture
 
   return texID;
 }
@@ -136,6 +299,7 @@ void windowSizeCallback(GLFWwindow *window, int width, int height)
   glfwGetFramebufferSize(g_window, &fbWidth, &fbHeight);
   g_camera.setAspectRatio((float)fbWidth / fbHeight);
   glViewport(0, 0, fbWidth, fbHeight);
+  g_viewportHeight = fbHeight;
   lastX = fbWidth / 2;
   lastY = fbHeight / 2;
   //   GLint viewport[4];
@@ -157,6 +321,20 @@ void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
   {
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
   }
+  else if (action == GLFW_PRESS && key == GLFW_KEY_G)
+  {
+    g_gpuPicking = !g_gpuPicking;
+    std::cout << "Picking " << (g_gpuPicking ? "with the GPU id buffer" : "with ray casts") << std::endl;
+  }
+  else if (action == GLFW_PRESS && key == GLFW_KEY_O)
+  {
+    g_occlusionCulling = !g_occlusionCulling;
+    std::cout << "Occlusion culling " << (g_occlusionCulling ? "on" : "off") << std::endl;
+  }
+  else if (action == GLFW_PRESS && key == GLFW_KEY_B)
+  {
+    std::cout << "GL binds of the last frame:\n" << g_glState.lastFrame() << std::flush;
+  }
   else if (action == GLFW_PRESS && (key == GLFW_KEY_ESCAPE || key == GLFW_KEY_Q))
   {
     glfwSetWindowShouldClose(window, true); // Closes the application if the escape key is pressed
@@ -201,6 +379,16 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos)
   g_camera.setFront(front);
 }
 
+// Asks for the body under the cursor, picked at the next frame
+void mouseButtonCallback(GLFWwindow *window, int button, int action, int)
+{
+  if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+  {
+    glfwGetCursorPos(window, &g_pickX, &g_pickY);
+    g_pickRequested = true;
+  }
+}
+
 void processInput(GLFWwindow *window)
 {
   if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -253,7 +441,7 @@ void initGLFW()
   // Create the window
   g_window = glfwCreateWindow(
       1024, 768,
-      "Interactive 3D Applications (OpenGL) - Simple Solar System",
+      kWindowTitle,
       nullptr, nullptr);
   if (!g_window)
   {
@@ -269,6 +457,7 @@ void initGLFW()
   // tell GLFW to capture our mouse
   // glfwSetCursorPosCallback(g_window, mouse_callback);
   glfwSetScrollCallback(g_window, scroll_callback);
+  glfwSetMouseButtonCallback(g_window, mouseButtonCallback);
   // glfwSetInputMode(g_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
   /// glfwSetInputMode(g_window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
 }
@@ -293,6 +482,7 @@ void initOpenGL()
   glfwGetFramebufferSize(g_window, &width, &height);
   // std::cout << "the width is " << width << " and the height is " << height << std::endl;
   glViewport(0, 0, width, height);
+  g_viewportHeight = height;
 }
 
 // Loads the content of an ASCII file in a standard C++ string
@@ -304,13 +494,40 @@ std::string file2String(const std::string &filename)
   return buffer.str();
 }
 
-// Loads and compile a shader, before attaching it to a program
-void loadShader(GLuint program, GLenum type, const std::string &shaderFilename)
+// True if filename was modified after the asset archive was written (false if either is missing)
+bool isNewerThanAssets(const std::string &filename)
+{
+  struct stat file, archive;
+  return stat(filename.c_str(), &file) == 0 && stat(kAssetArchive, &archive) == 0 && file.st_mtime > archive.st_mtime;
+}
+
+// Loads and compile a shader, before attaching it to a program.
+// defines (e.g., "#define INSTANCED\n") are inserted right after the #version line to select a shader variant.
+// The cooked source is used unless the loose file was edited since the cooking.
+void loadShader(GLuint program, GLenum type, const std::string &shaderFilename, const std::string &defines = "")
 {
-  GLuint shader = glCreateShader(type);                                    // Create the shader, e.g., a vertex shader to be applied to every single vertex of a mesh
-  std::string shaderSourceString = file2String(shaderFilename);            // Loads the shader source from a file to a C++ string
-  const GLchar *shaderSource = (const GLchar *)shaderSourceString.c_str(); // Interface the C++ string through a C pointer
-  glShaderSource(shader, 1, &shaderSource, NULL);                          // load the vertex shader code
+  GLuint shader = glCreateShader(type); // Create the shader, e.g., a vertex shader to be applied to every single vertex of a mesh
+  std::string fileSource;
+  const GLchar *source = nullptr;
+  GLint length = 0;
+  const AssetEntry *entry = g_assets ? g_assets->find(shaderFilename) : nullptr;
+  if (entry && entry->type == AssetType::Shader && !isNewerThanAssets(shaderFilename))
+  {
+    source = (const GLchar *)g_assets->data(*entry); // cooked source, read in place
+    length = (GLint)entry->size;
+  }
+  else
+  {
+    fileSource = file2String(shaderFilename); // Loads the shader source from a file to a C++ string
+    source = fileSource.c_str();
+    length = (GLint)fileSource.size();
+  }
+  // #version must stay the first line: the defines go between it and the rest of the source
+  const GLchar *lineEnd = std::find(source, source + length, '\n');
+  const GLint versionLength = (GLint)(lineEnd - source) + (lineEnd != source + length ? 1 : 0);
+  const GLchar *pieces[3] = {source, defines.c_str(), source + versionLength};
+  const GLint lengths[3] = {versionLength, (GLint)defines.size(), length - versionLength};
+  glShaderSource(shader, 3, pieces, lengths); // load the shader code
   glCompileShader(shader);
   GLint success;
   GLchar infoLog[512];
@@ -324,15 +541,76 @@ void loadShader(GLuint program, GLenum type, const std::string &shaderFilename)
   glDeleteShader(shader);
 }
 
+// Builds one variant of the GPU program from the vertex and fragment shaders
+GLuint createGPUprogram(const std::string &defines)
+{
+  GLuint program = glCreateProgram(); // Create a GPU program, i.e., two central shaders of the graphics pipeline
+  loadShader(program, GL_VERTEX_SHADER, "vertexShader.glsl", defines);
+  loadShader(program, GL_FRAGMENT_SHADER, "fragmentShader.glsl", defines);
+  glLinkProgram(program); // The GPU program is ready to be handle streams of polygons
+  return program;
+}
+
+void initAssets()
+{
+  g_assets = std::make_shared<AssetArchive>(kAssetArchive);
+  if (!g_assets->isOpen())
+  {
+    std::cout << "No " << kAssetArchive << " (build the cook target): loading and generating from the sources" << std::endl;
+    g_assets.reset();
+    return;
+  }
+  std::cout << "Loading " << g_assets->size() << " cooked assets from " << kAssetArchive << std::endl;
+  g_meshLibrary.setArchive(g_assets);
+}
+
+// Creates the materials of the bodies, once their textures are loaded
+void initMaterials()
+{
+  Material sun;
+  sun.lColor = glm::vec3(1.0f, 1.0f, 0.0f); // yellow
+  sun.emission = glm::vec3(1.0f, 0.9f, 0.5f);
+  g_sunMaterial = g_materials.create(sun);
+  Material earth;
+  earth.albedoTexture = g_albedoTexID;
+  earth.albedoLayer = kEarthLayer;
+  earth.lColor = glm::vec3(0.33f, 0.5f, 0.18f); // green
+  g_earthMaterial = g_materials.create(earth);
+  Material moon;
+  moon.albedoTexture = g_albedoTexID;
+  moon.albedoLayer = kMoonLayer;
+  moon.lColor = glm::vec3(0.3f, 0.3f, 0.7f); // blue
+  g_moonMaterial = g_materials.create(moon);
+  Material model; // the glTF materials are not loaded: lit in a plain color
+  model.albedoTexture = g_albedoTexID;
+  model.albedoLayer = kWhiteLayer;
+  model.lColor = glm::vec3(0.8f);
+  model.emission = glm::vec3(0.1f);
+  g_modelMaterial = g_materials.create(model);
+  Material rock;
+  rock.albedoTexture = g_albedoTexID;
+  rock.albedoLayer = kMoonLayer;
+  rock.lColor = glm::vec3(0.3f);
+  g_rockMaterial = g_materials.create(rock);
+}
+
 void initGPUprogram()
 {
-  g_program = glCreateProgram(); // Create a GPU program, i.e., two central shaders of the graphics pipeline
-  loadShader(g_program, GL_VERTEX_SHADER, "vertexShader.glsl");
-  loadShader(g_program, GL_FRAGMENT_SHADER, "fragmentShader.glsl");
-  g_earthTexID = loadTextureFromFileToGPU("../media/earth.jpg");
-  g_moonTexID = loadTextureFromFileToGPU("../media/moon.jpg");
-  glLinkProgram(g_program); // The main GPU program is ready to be handle streams of polygons
-  glUseProgram(g_program);
+  // the uniform handles are resolved once here: no name lookup when drawing
+  g_program.reset(createGPUprogram(""));
+  g_instancedProgram.reset(createGPUprogram("#define INSTANCED\n"));
+  g_orbitalProgram.reset(createGPUprogram("#define ORBITAL\n"));
+  g_proceduralProgram.reset(createGPUprogram("#define PROCEDURAL_SPHERE\n"));
+  g_terrainProgram.reset(createGPUprogram("#define TERRAIN\n"));
+  g_program.reportUnresolved("default");
+  g_instancedProgram.reportUnresolved("INSTANCED");
+  g_orbitalProgram.reportUnresolved("ORBITAL");
+  g_proceduralProgram.reportUnresolved("PROCEDURAL_SPHERE");
+  g_terrainProgram.reportUnresolved("TERRAIN");
+  g_frameData = std::make_shared<UniformBuffer>(kFrameDataBinding, sizeof(FrameData));
+  g_albedoTexID = loadTextureArrayFromFilesToGPU({"../media/earth.jpg", "../media/moon.jpg"}, {"media/earth.jpg", "media/moon.jpg"}); // AlbedoLayer order
+  initMaterials();
+  g_program.use();
   // TODO: set shader variables, textures, etc.
 }
 
@@ -357,7 +635,7 @@ void initGPUgeometry()
   // Create a single handle, vertex array object that contains attributes,
   // vertex buffer objects (e.g., vertex's position, normal, and color)
   glGenVertexArrays(1, &g_vao); // If your system doesn't support OpenGL 4.5, you should use this instead of glCreateVertexArrays.
-  glBindVertexArray(g_vao);
+  g_glState.bindVertexArray(g_vao);
 
   // Generate a GPU buffer to store the positions of the vertices
   size_t vertexBufferSize = sizeof(float) * g_vertexPositions.size(); // Gather the size of the buffer from the CPU-side vector
@@ -381,7 +659,7 @@ void initGPUgeometry()
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ibo);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferSize, g_triangleIndices.data(), GL_DYNAMIC_READ);
 
-  glBindVertexArray(0); // deactivate the VAO for now, will be activated again when rendering
+  g_glState.bindVertexArray(0); // deactivate the VAO for now, will be activated again when rendering
 }
 
 void initCamera()
@@ -400,39 +678,196 @@ void init()
   initGLFW();
   initOpenGL();
   // initCPUgeometry();
-  earthptr = Mesh::genSphere();
-  // std::cout << "Earth vertex size: "<<earthptr->getIndices().size()<<std::endl;
-  sunptr = Mesh::genSphere();
-  // std::cout << "Sun vertex size: "<<sunptr->getIndices().size()<<std::endl;
-  moonptr = Mesh::genSphere();
-  // std::cout << "Moon vertex size: "<<moonptr->getIndices().size()<<std::endl;
+  initAssets();
   initGPUprogram();
   // initGPUgeometry();
-  earthptr->init();
-  moonptr->init();
-  sunptr->init();
+  // the three bodies share the same spheres, generated and uploaded once by the library;
+  // which resolution each one draws is decided per frame by the level of detail
+  g_sphereLod = std::make_shared<SphereLod>(g_meshLibrary, kSphereGenerator);
+  const std::shared_ptr<Mesh> rock = g_meshLibrary.getSphere(8);
+  const std::vector<OrbitParams> beltOrbits = OrbitalBelt::genAsteroidBelt(kBeltSize, kBeltInnerRadius, kBeltOuterRadius, 0.02f, 0.06f);
+  beltptr = std::make_shared<OrbitalBelt>(rock, beltOrbits);
+  g_picker = std::make_shared<BodyPicker>(kPickBodyCount, beltOrbits, rock->boundingSphere().radius >= 0 ? rock->boundingSphere().radius : 1.0f);
+  g_idBuffer = std::make_shared<IdBuffer>();
+  g_occlusion = std::make_shared<OcclusionCuller>(g_meshLibrary.getCubeSphere(1));
+  g_earthTerrain = std::make_shared<PlanetTerrain>();
+  g_earthTerrain->init();
   initCamera();
+  g_meshLibrary.printMemoryReport();
 }
 
 void clear()
 {
-  glDeleteProgram(g_program);
+  earthptr.reset();
+  moonptr.reset();
+  sunptr.reset();
+  beltptr.reset();
+  g_earthTerrain.reset();
+  g_picker.reset();
+  g_idBuffer.reset();
+  g_occlusion.reset();
+  g_model.reset();
+  g_sphereLod.reset();
+  g_meshLibrary.clear();
+  g_meshLibrary.setArchive(nullptr);
+  g_materials.clear();
+  g_assets.reset();
+  g_frameData.reset();
+  g_program.reset();
+  g_instancedProgram.reset();
+  g_orbitalProgram.reset();
+  g_proceduralProgram.reset();
+  g_terrainProgram.reset();
   glfwDestroyWindow(g_window);
   glfwTerminate();
 }
 
+// False when the object space bounds, placed by model, are outside the frustum; meshes without bounds are always drawn.
+// Counts the result in stats, unless nullptr.
+bool isVisible(const Frustum &frustum, const BoundingSphere &bounds, const glm::mat4 &model, CullStats *stats)
+{
+  const bool visible = bounds.radius < 0 || frustum.intersects(transformSphere(bounds, model));
+  if (stats && visible)
+    ++stats->drawn;
+  else if (stats)
+    ++stats->culled;
+  return visible;
+}
+
+// Shows the culling counts once per second
+void updateWindowTitle(const float currentTime)
+{
+  if (currentTime - g_lastTitleTime < 1.0f)
+    return;
+  g_lastTitleTime = currentTime;
+  std::ostringstream title;
+  title << kWindowTitle << " - drawn " << g_cullStats.drawn << ", culled " << g_cullStats.culled;
+  if (g_occlusionCulling)
+    title << ", occluded " << g_occlusion->skippedCount() << " of " << g_occlusion->testedCount();
+  title << " - state changes " << g_queueStats.submittedChanges << " -> " << g_queueStats.sortedChanges << " sorted";
+  title << " - binds " << g_glState.lastFrame().totalIssued() << " issued, " << g_glState.lastFrame().totalSkipped() << " skipped";
+  title << " - picked " << g_pickedName;
+  glfwSetWindowTitle(g_window, title.str().c_str());
+}
+
+// Name of a picked body, -1 for none
+std::string pickedBodyName(const int body)
+{
+  const char *names[kPickBodyCount] = {"sun", "earth", "moon", "model"};
+  if (body < 0)
+    return "nothing";
+  if (body < kPickBodyCount)
+    return names[body];
+  return "rock " + std::to_string(body - kPickBodyCount);
+}
+
+// Queues a mesh unless it is outside the frustum
+void submitBody(const Frustum &frustum, const std::shared_ptr<Mesh> &mesh, const glm::mat4 &model, const MaterialHandle material,
+                const PickBody body, CullStats *stats)
+{
+  if (!isVisible(frustum, mesh->boundingSphere(), model, stats))
+    return;
+  DrawItem item;
+  item.mesh = mesh.get();
+  item.model = model;
+  item.material = material;
+  item.pickId = body + 1;
+  item.bounds = transformSphere(mesh->boundingSphere(), model);
+  g_renderQueue.submit(item);
+}
+
+// Draws the bodies placed by g_sun, g_earth and g_moon through the render queue. With occlusion, the queue draws
+// them nearest first so that they can hide the ones behind; the earth terrain replaces its sphere on close approaches.
+// stats: culling counts of the pass, nullptr for the picking one (which also leaves g_queueStats to the main pass).
+void drawScene(const Frustum &frustum, const float time, const bool terrain, const bool occlusion, CullStats *stats)
+{
+  if (terrain)
+    g_earthTerrain->render(g_earth, g_earthMaterial, kPickEarth + 1); // the camera is close: never hidden
+  g_renderQueue.setSortMode(occlusion ? SortMode::FrontToBack : SortMode::State);
+  g_renderQueue.begin(g_camera);
+  if (!terrain)
+    submitBody(frustum, earthptr, g_earth, g_earthMaterial, kPickEarth, stats);
+  submitBody(frustum, moonptr, g_moon, g_moonMaterial, kPickMoon, stats);
+  submitBody(frustum, sunptr, g_sun, g_sunMaterial, kPickSun, stats);
+  if (g_model)
+    for (const std::shared_ptr<Mesh> &mesh : g_model->meshes())
+      submitBody(frustum, mesh, g_modelMat, g_modelMaterial, kPickModel, stats);
+  g_renderQueue.execute(occlusion ? g_occlusion.get() : nullptr);
+  // the belt surrounds the sun: its bounds are never hidden
+  if (isVisible(frustum, beltptr->boundingSphere(), glm::mat4(1.0f), stats))
+    beltptr->render(time, g_rockMaterial, kPickBodyCount + 1); // rocks, one uniform per frame
+}
+
+// Picks the body under the cursor of the last click: at once with a ray cast, or with the id buffer a few frames
+// later (see pollGpuPick)
+void pick(const Frustum &frustum, const float time, const bool terrain)
+{
+  int width, height, fbWidth, fbHeight;
+  glfwGetWindowSize(g_window, &width, &height);
+  glfwGetFramebufferSize(g_window, &fbWidth, &fbHeight);
+  if (g_gpuPicking)
+  {
+    // the pixel under the cursor, in framebuffer pixels from the bottom left: row 0 is the last one from the top
+    g_idBuffer->begin(fbWidth, fbHeight, (int)(g_pickX * fbWidth / width), fbHeight - 1 - (int)(g_pickY * fbHeight / height));
+    drawScene(frustum, time, terrain, false, nullptr);
+    g_idBuffer->end();
+    return;
+  }
+
+  const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+  g_picker->setBody(kPickSun, transformSphere(sunptr->boundingSphere(), g_sun));
+  g_picker->setBody(kPickEarth, transformSphere(earthptr->boundingSphere(), g_earth));
+  g_picker->setBody(kPickMoon, transformSphere(moonptr->boundingSphere(), g_moon));
+  BoundingSphere modelBounds;
+  if (g_model)
+  {
+    Aabb box;
+    box.min = g_model->boundsMin();
+    box.max = g_model->boundsMax();
+    modelBounds = transformSphere(boundingSphereOf(box), g_modelMat);
+  }
+  g_picker->setBody(kPickModel, modelBounds);
+  glm::vec3 origin, direction;
+  g_camera.computeRay(glm::vec2(2.0 * g_pickX / width - 1.0, 1.0 - 2.0 * g_pickY / height), origin, direction);
+  float distance = 0.0f;
+  const int body = g_picker->pick(time, origin, direction, distance);
+  const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  g_pickedName = pickedBodyName(body);
+  std::cout << "Picked " << g_pickedName;
+  if (body >= 0)
+    std::cout << " at a distance of " << distance;
+  std::cout << " (ray cast in " << milliseconds << " ms)" << std::endl;
+}
+
+// Takes the result of the id buffer once the GPU has copied it
+void pollGpuPick()
+{
+  GLuint id = 0;
+  if (!g_idBuffer->poll(id))
+    return;
+  g_pickedName = pickedBodyName((int)id - 1);
+  std::cout << "Picked " << g_pickedName << " (id buffer)" << std::endl;
+}
+
+// Camera and light shared by every draw of the frame, uploaded once
+void updateFrameData()
+{
+  FrameData frame = FrameData();
+  frame.viewMat = g_camera.computeViewMatrix(); // compute the view matrix of the camera and pass it to the GPU program
+  frame.projMat = g_camera.computeProjectionMatrix(); // compute the projection matrix of the camera and pass it to the GPU program
+  frame.camPos = g_camera.getPosition();
+  frame.lightPos = glm::vec3(0.0f); // if Sun is at origin
+  g_frameData->update(frame);
+}
+
 // The main rendering call
 void render()
 {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
 
-  const glm::mat4 viewMatrix = g_camera.computeViewMatrix();
-  const glm::mat4 projMatrix = g_camera.computeProjectionMatrix();
-
-  glUniformMatrix4fv(glGetUniformLocation(g_program, "viewMat"), 1, GL_FALSE, glm::value_ptr(viewMatrix)); // compute the view matrix of the camera and pass it to the GPU program
-  glUniformMatrix4fv(glGetUniformLocation(g_program, "projMat"), 1, GL_FALSE, glm::value_ptr(projMatrix)); // compute the projection matrix of the camera and pass it to the GPU program
+  updateFrameData();
 
-  glBindVertexArray(g_vao);                                                   // activate the VAO storing geometry data
+  g_glState.bindVertexArray(g_vao);                                           // activate the VAO storing geometry data
   glDrawElements(GL_TRIANGLES, g_triangleIndices.size(), GL_UNSIGNED_INT, 0); // Call for rendering: stream the current GPU geometry through the current GPU program
 }
 
@@ -458,10 +893,17 @@ void update(const float currentTimeInSec)
 int main(int argc, char **argv)
 {
   init(); // Your initialization code (user interface, OpenGL states, scene with geometry, material, lights, etc)
+  if (argc > 1 && (g_model = GlbModel::load(argv[1])))
+  {
+    const glm::vec3 center = 0.5f * (g_model->boundsMin() + g_model->boundsMax());
+    const float radius = std::max(0.5f * glm::length(g_model->boundsMax() - g_model->boundsMin()), 1e-6f);
+    g_modelMat = glm::translate(glm::mat4(1.0f), kModelPosition) * glm::scale(glm::mat4(1.0f), glm::vec3(kModelRadius / radius)) * glm::translate(glm::mat4(1.0f), -center);
+  }
   while (!glfwWindowShouldClose(g_window))
   {
     // animate
-    update(static_cast<float>(glfwGetTime()));
+    const float currentTime = static_cast<float>(glfwGetTime());
+    update(currentTime);
     processInput(g_window);
 
     // Tilt in earth
@@ -502,10 +944,42 @@ int main(int argc, char **argv)
     moonModel = glm::rotate(moonModel, moonRotation, glm::vec3(0, 0, 1));
     moonModel = glm::scale(moonModel, glm::vec3(kSizeMoon));
 
+    // level of detail from the projected size of each body
+    g_sunLod = g_sphereLod->selectLevel(g_sunLod, SphereLod::projectedRadius(g_camera, glm::vec3(sunModel[3]), kSizeSun, g_viewportHeight));
+    g_earthLod = g_sphereLod->selectLevel(g_earthLod, SphereLod::projectedRadius(g_camera, glm::vec3(earthModel[3]), kSizeEarth, g_viewportHeight));
+    g_moonLod = g_sphereLod->selectLevel(g_moonLod, SphereLod::projectedRadius(g_camera, glm::vec3(moonModel[3]), kSizeMoon, g_viewportHeight));
+    sunptr = g_sphereLod->mesh(g_sunLod);
+    earthptr = g_sphereLod->mesh(g_earthLod);
+    moonptr = g_sphereLod->mesh(g_moonLod);
+    g_sun = sunModel;
+    g_earth = earthModel;
+    g_moon = moonModel;
+
+    updateFrameData();
+    const Frustum frustum = g_camera.computeFrustum();
+    const glm::vec3 earthCamera = glm::vec3(glm::inverse(earthModel) * glm::vec4(g_camera.getPosition(), 1.0f)); // in earth radii
+    const bool terrain = glm::length(earthCamera) < kTerrainDistance;
+    if (terrain)
+    {
+      // close approach: only the patches near the camera are refined, the terrain culls its own patches
+      g_earthTerrain->select(earthCamera, Frustum::fromMatrix(g_camera.computeProjectionMatrix() * g_camera.computeViewMatrix() * earthModel),
+                             PlanetTerrain::projectionScale(g_camera, g_viewportHeight));
+    }
+    if (g_pickRequested)
+    {
+      pick(frustum, currentTime, terrain);
+      g_pickRequested = false;
+    }
+    pollGpuPick();
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    earthptr->render(earthModel, glm::vec3(0.33, 0.5, 0.18), glm::vec3(0.0f), g_earthTexID, "earth"); // green
-    moonptr->render(moonModel, glm::vec3(0.3, 0.3, 0.7), glm::vec3(0.0f), g_moonTexID, "moon");       // blue
-    sunptr->render(sunModel, glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.9f, 0.5f), 10, "sun");    // yellow
+    g_cullStats = CullStats();
+    if (g_occlusionCulling)
+      g_occlusion->beginFrame();
+    drawScene(frustum, currentTime, terrain, g_occlusionCulling, &g_cullStats);
+    g_queueStats = g_renderQueue.stats();
+    g_glState.endFrame();
+    updateWindowTitle(currentTime);
     glfwSwapBuffers(g_window);
     glfwPollEvents();
   }
@@ -0,0 +1,41 @@
+#include "material.h"
+#include <iostream>
+#include <limits>
+#include "glstate.h"
+
+void Material::apply(const SceneProgram &program) const
+{
+    g_glState.bindTexture(0, GL_TEXTURE_2D_ARRAY, albedoTexture);
+    program.albedoTex.set(0);
+    program.albedoLayer.set((float)albedoLayer);
+    program.lColor.set(lColor);
+    program.emission.set(emission);
+}
+
+MaterialLibrary::MaterialLibrary()
+{
+    clear();
+}
+
+MaterialHandle MaterialLibrary::create(const Material &material)
+{
+    if (m_materials.size() > std::numeric_limits<MaterialHandle>::max())
+    {
+        std::cout << "ERROR: too many materials, using the default one" << std::endl;
+        return kDefaultMaterial;
+    }
+    m_materials.push_back(material);
+    return m_materials.size() - 1;
+}
+
+const Material &MaterialLibrary::get(const MaterialHandle handle) const
+{
+    return handle < m_materials.size() ? m_materials[handle] : m_materials[kDefaultMaterial];
+}
+
+size_t MaterialLibrary::size() const { return m_materials.size(); }
+
+void MaterialLibrary::clear()
+{
+    m_materials.assign(1, Material());
+}
@@ -0,0 +1,50 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/gl.h>
+#include "shaderprogram.h"
+
+// Small index into g_materials: what draws carry instead of their textures and colors
+typedef uint16_t MaterialHandle;
+
+// Black and not lit: for draws whose color does not matter (e.g., occlusion proxies); always in the library
+const MaterialHandle kDefaultMaterial = 0;
+
+// Surface of a body, created once and shared by its draws
+struct Material
+{
+  GLuint albedoTexture = 0; // GL_TEXTURE_2D_ARRAY sampled as material.albedoTex, 0 for black
+  int albedoLayer = 0;      // layer of albedoTexture, for every draw but Mesh::renderInstanced (per instance)
+  glm::vec3 lColor = glm::vec3(0.0f);
+  glm::vec3 emission = glm::vec3(0.0f);
+  // Shader variant for the meshes with vertex buffers, nullptr for g_program (procedural spheres always use
+  // g_proceduralProgram, which rebuilds their vertices)
+  const SceneProgram *program = nullptr;
+
+  // Binds the albedo texture array to unit 0 and sets the per-draw uniforms of program, which must be in use
+  void apply(const SceneProgram &program) const;
+};
+
+// Every material of the scene, addressed by handle; handles stay valid until clear()
+class MaterialLibrary
+{
+public:
+  MaterialLibrary();
+
+  MaterialHandle create(const Material &material);
+  // The default material for a handle out of range
+  const Material &get(const MaterialHandle handle) const;
+  size_t size() const;
+  // Removes every material but the default one
+  void clear();
+
+private:
+  std::vector<Material> m_materials;
+};
+
+extern MaterialLibrary g_materials;
+
+#endif // MATERIAL_H
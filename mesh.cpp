@@ -2,170 +2,936 @@
 #include <iostream>
 #include <vector>
 #include <memory>
-#include <glm/gtc/type_ptr.hpp>
+#include <cstddef>
+#include <cmath>
+#include <map>
+#include <algorithm>
+#include <utility>
+#include <thread>
 #include "camera.h"
+#include "meshopt.h"
+#include "glstate.h"
+#include "material.h"
 
-extern GLuint g_program;
-extern Camera g_camera;
+const unsigned int Mesh::kRestartIndex;
 
 // Class that defines the attributes of a mesh
-std::vector<unsigned int> Mesh::getIndices() const
+const IndexArray &Mesh::getIndices() const
 {
     return m_triangleIndices;
 }
 
-void Mesh::init()
+const FloatArray &Mesh::getPositions() const
+{
+    return m_vertexPositions;
+}
+
+const FloatArray &Mesh::getNormals() const
+{
+    return m_vertexNormals;
+}
+
+const FloatArray &Mesh::getTexCoords() const
+{
+    return m_vertexTexCoords;
+}
+
+GLenum Mesh::getPrimitive() const
+{
+    return m_primitive;
+}
+
+size_t Mesh::vertexCount() const { return m_vertexCount; }
+
+size_t Mesh::indexCount() const { return m_indexCount; }
+
+const Aabb &Mesh::bounds() const { return m_bounds; }
+
+const BoundingSphere &Mesh::boundingSphere() const { return m_boundingSphere; }
+
+// Every generator builds the unit sphere: no need to go through the vertices
+void Mesh::setUnitSphereBounds()
+{
+    m_bounds.min = glm::vec3(-1.0f);
+    m_bounds.max = glm::vec3(1.0f);
+    m_boundingSphere.center = glm::vec3(0.0f);
+    m_boundingSphere.radius = 1.0f;
+}
+
+size_t Mesh::cpuBytes() const
+{
+    return sizeof(float) * (m_vertexPositions.capacity() + m_vertexNormals.capacity() + m_vertexTexCoords.capacity()) +
+           sizeof(unsigned int) * m_triangleIndices.capacity();
+}
+
+size_t Mesh::gpuBytes() const
+{
+    return m_gpuBytes + sizeof(InstanceData) * m_instanceCapacity;
+}
+
+Mesh::~Mesh()
+{
+    // nothing to release for meshes that never reached the GPU (e.g., in the tools, without GL context)
+    const GLuint buffers[] = {m_vbo, m_posVbo, m_normalVbo, m_texCoordVbo, m_instanceVbo,
+                              m_layout == VertexLayout::External ? 0 : m_ibo}; // external buffers belong to their owner
+    for (const GLuint buffer : buffers)
+        if (buffer != 0)
+            glDeleteBuffers(1, &buffer);
+    const GLuint vaos[] = {m_vao, m_instanceVao};
+    for (const GLuint vao : vaos)
+        if (vao != 0)
+        {
+            g_glState.forgetVertexArray(vao);
+            glDeleteVertexArrays(1, &vao);
+        }
+}
+
+void Mesh::optimize()
+{
+    if (m_primitive != GL_TRIANGLES)
+        return;
+    const size_t vertexCount = m_vertexPositions.size() / 3;
+    optimizeVertexCache(m_triangleIndices, vertexCount);
+    size_t newVertexCount = 0;
+    const std::vector<unsigned int> remap = optimizeVertexFetch(m_triangleIndices, vertexCount, newVertexCount);
+    remapVertexAttribute(m_vertexPositions, 3, remap, newVertexCount);
+    remapVertexAttribute(m_vertexNormals, 3, remap, newVertexCount);
+    remapVertexAttribute(m_vertexTexCoords, 2, remap, newVertexCount);
+}
+
+void Mesh::init(const VertexLayout layout, const RetentionPolicy retention)
 {                                 // generate buffers
+    m_layout = layout;
+    m_vertexCount = m_vertexPositions.size() / 3;
+    if (m_bounds.isEmpty() && retention != RetentionPolicy::DropAfterUpload)
+    {
+        m_bounds = computeAabb(m_vertexPositions);
+        m_boundingSphere = computeBoundingSphere(m_vertexPositions, m_bounds);
+    }
     glGenVertexArrays(1, &m_vao); // If your system doesn't support OpenGL 4.5, you should use this instead of glCreateVertexArrays.
-    glBindVertexArray(m_vao);
+    g_glState.bindVertexArray(m_vao);
+    if (m_proceduralResolution > 0)
+    {
+        g_glState.bindVertexArray(0); // an empty VAO is all the core profile needs to draw without attributes
+        return;
+    }
+
+    if (m_layout == VertexLayout::Interleaved)
+        initInterleavedBuffers();
+    else if (m_layout == VertexLayout::Split)
+        initSplitBuffers();
+    else
+        initQuantizedBuffers();
+
+    initIndexBuffer();
+    bindVertexAttributes();
+    g_glState.bindVertexArray(0);
+
+    if (retention != RetentionPolicy::Keep)
+    {
+        // swap with empty vectors: clear() would keep the capacity
+        FloatArray().swap(m_vertexPositions);
+        FloatArray().swap(m_vertexNormals);
+        FloatArray().swap(m_vertexTexCoords);
+        IndexArray().swap(m_triangleIndices);
+    }
+    if (retention == RetentionPolicy::DropAfterUpload)
+    {
+        // analytic bounds included: nothing may cull or pick this mesh
+        m_bounds = Aabb();
+        m_boundingSphere = BoundingSphere();
+    }
+};
+
+std::shared_ptr<Mesh> Mesh::clone() const
+{
+    if (m_vao != 0)
+    {
+        std::cout << "ERROR: cannot clone a mesh already on the GPU" << std::endl;
+        return nullptr;
+    }
+    std::shared_ptr<Mesh> meshPtr = std::make_shared<Mesh>();
+    meshPtr->m_vertexPositions = m_vertexPositions;
+    meshPtr->m_vertexNormals = m_vertexNormals;
+    meshPtr->m_triangleIndices = m_triangleIndices;
+    meshPtr->m_vertexTexCoords = m_vertexTexCoords;
+    meshPtr->m_proceduralResolution = m_proceduralResolution;
+    meshPtr->m_primitive = m_primitive;
+    meshPtr->m_bounds = m_bounds;
+    meshPtr->m_boundingSphere = m_boundingSphere;
+    return meshPtr;
+}
+
+namespace
+{
+// Largest index of the type, used as the primitive restart index
+GLuint maxIndex(const GLenum indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? 0xFFFF : 0xFFFFFFFF;
+}
+
+// Copies the indices with the given integer type, strip ends becoming the restart index of the type
+template <typename T>
+std::vector<T> packIndices(const IndexArray &indices)
+{
+    std::vector<T> packed(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+        packed[i] = indices[i] == Mesh::kRestartIndex ? (T)~(T)0 : (T)indices[i];
+    return packed;
+}
+} // namespace
+
+// generate EBO with 16-bit indices when the vertex count allows it: 2 bytes per index instead of 4 on most
+// meshes. 8-bit indices are not used: GPUs fetch them slowly or convert them to 16 bits in the driver.
+// The largest value of the type is kept free for the primitive restart of the strips.
+void Mesh::initIndexBuffer()
+{
+    const size_t vertexCount = m_vertexPositions.size() / 3;
+    m_indexCount = m_triangleIndices.size();
+    m_primitiveRestart = std::find(m_triangleIndices.begin(), m_triangleIndices.end(), kRestartIndex) != m_triangleIndices.end();
+    glGenBuffers(1, &m_ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+    if (vertexCount <= 0xFFFF)
+    {
+        m_indexType = GL_UNSIGNED_SHORT;
+        const std::vector<GLushort> packed = packIndices<GLushort>(m_triangleIndices);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * packed.size(), packed.data(), GL_STATIC_DRAW);
+        m_gpuBytes += sizeof(GLushort) * packed.size();
+    }
+    else
+    {
+        m_indexType = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * m_triangleIndices.size(), m_triangleIndices.data(), GL_STATIC_DRAW);
+        m_gpuBytes += sizeof(unsigned int) * m_triangleIndices.size();
+    }
+}
+
+// Packs the three attribute arrays into one array of Vertex and uploads it in a single VBO,
+// so that fetching a vertex touches one buffer instead of three
+void Mesh::initInterleavedBuffers()
+{
+    const size_t vertexCount = m_vertexPositions.size() / 3;
+    std::vector<Vertex> vertices(vertexCount);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        vertices[i].position = glm::vec3(m_vertexPositions[3 * i], m_vertexPositions[3 * i + 1], m_vertexPositions[3 * i + 2]);
+        vertices[i].normal = glm::vec3(m_vertexNormals[3 * i], m_vertexNormals[3 * i + 1], m_vertexNormals[3 * i + 2]);
+        vertices[i].texCoord = glm::vec2(m_vertexTexCoords[2 * i], m_vertexTexCoords[2 * i + 1]);
+    }
+
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    m_gpuBytes += sizeof(Vertex) * vertices.size();
+}
 
+// Legacy layout: one VBO per attribute, kept to compare the vertex fetch throughput
+void Mesh::initSplitBuffers()
+{
     //  Generate a GPU buffer to store the positions of the vertices
     size_t positionSize = sizeof(float) * m_vertexPositions.size(); // Gather the size of the buffer from the CPU-side vector
-    // std::cout<<"The position size is: "<<positionSize<<std::endl;
     glGenBuffers(1, &m_posVbo);
     glBindBuffer(GL_ARRAY_BUFFER, m_posVbo);
     glBufferData(GL_ARRAY_BUFFER, positionSize, m_vertexPositions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
-    glEnableVertexAttribArray(0);
 
     // initialize normal buffer
     size_t normalSize = sizeof(float) * m_vertexNormals.size(); // Gather the size of the buffer from the CPU-side vector
     glGenBuffers(1, &m_normalVbo);
     glBindBuffer(GL_ARRAY_BUFFER, m_normalVbo);
     glBufferData(GL_ARRAY_BUFFER, normalSize, m_vertexNormals.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
-    glEnableVertexAttribArray(1);
 
     // initialize tex buffer
     size_t texSize = sizeof(float) * m_vertexTexCoords.size(); // Gather the size of the buffer from the CPU-side vector
-    // std::cout << "The tex coords vertex size is: " << texSize << std::endl;
-    // for (size_t i = 0; i < 5; ++i)
-    // {
-    //     std::cout << m_vertexTexCoords[i] << " ";
-    // }
-    std::cout << std::endl;
     glGenBuffers(1, &m_texCoordVbo);
     glBindBuffer(GL_ARRAY_BUFFER, m_texCoordVbo);
     glBufferData(GL_ARRAY_BUFFER, texSize, m_vertexTexCoords.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), 0);
-    glEnableVertexAttribArray(2);
+    m_gpuBytes += positionSize + normalSize + texSize;
+}
 
-    // generate EBO
-    size_t indexBufferSize = sizeof(unsigned int) * m_triangleIndices.size();
-    glGenBuffers(1, &m_ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferSize, m_triangleIndices.data(), GL_STATIC_DRAW);
+namespace
+{
+// Quantized attributes are fed to the shader as plain (non normalized) integers and scaled there,
+// since the snorm conversion rule differs between GL versions
+const float kSnorm8 = 127.0f;
+const float kSnorm16 = 32767.0f;
 
-    glBindVertexArray(0);
-};
-void Mesh::render(const glm::mat4 &model, const glm::vec3 &lColor,
-                  const glm::vec3 &emission, GLuint texture, std::string planet)
+GLshort toSnorm16(const float v) { return (GLshort)roundf(glm::clamp(v, -1.0f, 1.0f) * kSnorm16); }
+GLbyte toSnorm8(const float v) { return (GLbyte)roundf(glm::clamp(v, -1.0f, 1.0f) * kSnorm8); }
+GLushort toUnorm16(const float v) { return (GLushort)roundf(glm::clamp(v, 0.0f, 1.0f) * 65535.0f); }
+
+// Octahedral normal encoding (Meyer et al.): the unit sphere is folded onto a square of [-1, 1]^2
+glm::vec2 octEncode(const glm::vec3 &n)
 {
-    glUseProgram(g_program);
-    // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
-    const glm::vec3 camPosition = g_camera.getPosition();
-    glUniform3f(glGetUniformLocation(g_program, "camPos"), camPosition[0], camPosition[1], camPosition[2]);
-    const glm::mat4 viewMatrix = g_camera.computeViewMatrix();
-    const glm::mat4 projMatrix = g_camera.computeProjectionMatrix();
-    glUniformMatrix4fv(glGetUniformLocation(g_program, "modelMat"), 1, GL_FALSE, glm::value_ptr(model));     // pass the model matrix to the GPU program
-    glUniformMatrix4fv(glGetUniformLocation(g_program, "viewMat"), 1, GL_FALSE, glm::value_ptr(viewMatrix)); // compute the view matrix of the camera and pass it to the GPU program
-    glUniformMatrix4fv(glGetUniformLocation(g_program, "projMat"), 1, GL_FALSE, glm::value_ptr(projMatrix)); // compute the projection matrix of the camera and pass it to the GPU program
-    glUniform3f(glGetUniformLocation(g_program, "lColor"), lColor[0], lColor[1], lColor[2]);
-    glUniform3fv(glGetUniformLocation(g_program, "emission"), 1, glm::value_ptr(emission));
-    glm::vec3 lightPos = glm::vec3(0.0f); // if Sun is at origin
-    glUniform3fv(glGetUniformLocation(g_program, "lightPos"), 1, glm::value_ptr(lightPos));
-    if (planet == "earth")
-    {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glUniform1i(glGetUniformLocation(g_program, "material.albedoTex"), 0);
-    }
-    else if (planet == "moon")
-    {
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glUniform1i(glGetUniformLocation(g_program, "material.albedoTex"), 1);
+    glm::vec2 e = glm::vec2(n) / (fabsf(n.x) + fabsf(n.y) + fabsf(n.z));
+    if (n.z < 0)
+        e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * glm::vec2(e.x >= 0 ? 1.0f : -1.0f, e.y >= 0 ? 1.0f : -1.0f);
+    return e;
+}
+
+// Same as octDecode() in vertexShader.glsl
+glm::vec3 octDecode(const glm::vec2 &e)
+{
+    glm::vec3 n(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+    const float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0 ? -t : t;
+    n.y += n.y >= 0 ? -t : t;
+    return glm::normalize(n);
+}
+
+// Dequantization of the positions: the bounding box of the mesh is mapped onto [-1, 1]^3
+void positionDecode(const FloatArray &positions, glm::vec3 &offset, glm::vec3 &scale)
+{
+    glm::vec3 lo(0.0f), hi(0.0f);
+    for (size_t i = 0; i + 2 < positions.size(); i += 3)
+    {
+        const glm::vec3 p(positions[i], positions[i + 1], positions[i + 2]);
+        lo = i == 0 ? p : glm::min(lo, p);
+        hi = i == 0 ? p : glm::max(hi, p);
+    }
+    offset = (lo + hi) * 0.5f;
+    scale = glm::max((hi - lo) * 0.5f, glm::vec3(1e-12f)) / kSnorm16;
+}
+
+// Dequantization of the texcoords: their bounds are mapped onto [0, 1]^2, so that the ones past 1 (the seam
+// triangles of fillSphereAttributes) keep their value instead of being clamped
+void texCoordDecode(const FloatArray &texCoords, glm::vec2 &offset, glm::vec2 &scale)
+{
+    glm::vec2 lo(0.0f), hi(1.0f);
+    for (size_t i = 0; i + 1 < texCoords.size(); i += 2)
+    {
+        const glm::vec2 t(texCoords[i], texCoords[i + 1]);
+        lo = i == 0 ? t : glm::min(lo, t);
+        hi = i == 0 ? t : glm::max(hi, t);
+    }
+    offset = lo;
+    scale = glm::max(hi - lo, glm::vec2(1e-12f));
+}
+} // namespace
+
+// Quantized layout: 12 or 16 bytes per vertex instead of 32, decoded in the vertex shader
+void Mesh::initQuantizedBuffers()
+{
+    positionDecode(m_vertexPositions, m_posOffset, m_posScale);
+    const glm::vec3 invExtent = 1.0f / (m_posScale * kSnorm16);
+    texCoordDecode(m_vertexTexCoords, m_uvOffset, m_uvScale);
+    const size_t vertexCount = m_vertexPositions.size() / 3;
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (m_layout == VertexLayout::QuantizedOct8)
+    {
+        m_octScale = 1.0f / kSnorm8;
+        std::vector<QuantizedVertex8> vertices(vertexCount);
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            const glm::vec3 p = (glm::vec3(m_vertexPositions[3 * i], m_vertexPositions[3 * i + 1], m_vertexPositions[3 * i + 2]) - m_posOffset) * invExtent;
+            const glm::vec2 n = octEncode(glm::vec3(m_vertexNormals[3 * i], m_vertexNormals[3 * i + 1], m_vertexNormals[3 * i + 2]));
+            QuantizedVertex8 &v = vertices[i];
+            v.position[0] = toSnorm16(p.x), v.position[1] = toSnorm16(p.y), v.position[2] = toSnorm16(p.z);
+            v.normal[0] = toSnorm8(n.x), v.normal[1] = toSnorm8(n.y);
+            const glm::vec2 t = (glm::vec2(m_vertexTexCoords[2 * i], m_vertexTexCoords[2 * i + 1]) - m_uvOffset) / m_uvScale;
+            v.texCoord[0] = toUnorm16(t.x), v.texCoord[1] = toUnorm16(t.y);
+        }
+        glBufferData(GL_ARRAY_BUFFER, sizeof(QuantizedVertex8) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+        m_gpuBytes += sizeof(QuantizedVertex8) * vertices.size();
     }
     else
     {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        m_octScale = 1.0f / kSnorm16;
+        std::vector<QuantizedVertex16> vertices(vertexCount);
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            const glm::vec3 p = (glm::vec3(m_vertexPositions[3 * i], m_vertexPositions[3 * i + 1], m_vertexPositions[3 * i + 2]) - m_posOffset) * invExtent;
+            const glm::vec2 n = octEncode(glm::vec3(m_vertexNormals[3 * i], m_vertexNormals[3 * i + 1], m_vertexNormals[3 * i + 2]));
+            QuantizedVertex16 &v = vertices[i];
+            v.position[0] = toSnorm16(p.x), v.position[1] = toSnorm16(p.y), v.position[2] = toSnorm16(p.z), v.position[3] = 0;
+            v.normal[0] = toSnorm16(n.x), v.normal[1] = toSnorm16(n.y);
+            const glm::vec2 t = (glm::vec2(m_vertexTexCoords[2 * i], m_vertexTexCoords[2 * i + 1]) - m_uvOffset) / m_uvScale;
+            v.texCoord[0] = toUnorm16(t.x), v.texCoord[1] = toUnorm16(t.y);
+        }
+        glBufferData(GL_ARRAY_BUFFER, sizeof(QuantizedVertex16) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+        m_gpuBytes += sizeof(QuantizedVertex16) * vertices.size();
+    }
+}
+
+QuantizationError Mesh::quantizationError(const VertexLayout layout) const
+{
+    glm::vec2 uvOffset, uvScale;
+    texCoordDecode(m_vertexTexCoords, uvOffset, uvScale);
+    QuantizationError error = {0.0f, 0.0f, 0.0f, uvOffset, uvOffset + uvScale};
+    if (layout == VertexLayout::Interleaved || layout == VertexLayout::Split)
+        return error;
+    const bool oct8 = layout == VertexLayout::QuantizedOct8;
+    glm::vec3 offset, scale;
+    positionDecode(m_vertexPositions, offset, scale);
+    const size_t vertexCount = m_vertexPositions.size() / 3;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        // encode then decode exactly as the upload and the vertex shader do
+        const glm::vec3 p(m_vertexPositions[3 * i], m_vertexPositions[3 * i + 1], m_vertexPositions[3 * i + 2]);
+        const glm::vec3 q = (p - offset) / (scale * kSnorm16);
+        const glm::vec3 decodedP = offset + scale * glm::vec3(toSnorm16(q.x), toSnorm16(q.y), toSnorm16(q.z));
+        error.position = std::max(error.position, glm::length(decodedP - p));
+
+        const glm::vec3 n = glm::normalize(glm::vec3(m_vertexNormals[3 * i], m_vertexNormals[3 * i + 1], m_vertexNormals[3 * i + 2]));
+        const glm::vec2 e = octEncode(n);
+        const glm::vec2 decodedE = oct8 ? glm::vec2(toSnorm8(e.x), toSnorm8(e.y)) / kSnorm8
+                                        : glm::vec2(toSnorm16(e.x), toSnorm16(e.y)) / kSnorm16;
+        const float cosAngle = glm::clamp(glm::dot(octDecode(decodedE), n), -1.0f, 1.0f);
+        error.normalDegrees = std::max(error.normalDegrees, glm::degrees(acosf(cosAngle)));
+
+        for (int k = 0; k < 2; ++k)
+        {
+            const float t = m_vertexTexCoords[2 * i + k];
+            const float decodedT = uvOffset[k] + uvScale[k] * (toUnorm16((t - uvOffset[k]) / uvScale[k]) / 65535.0f);
+            error.texCoord = std::max(error.texCoord, fabsf(decodedT - t));
+        }
     }
-    //std::cout << "Planet " << planet << " 's texture id is " << texture << std::endl;
-    glBindVertexArray(m_vao); // activate the VAO storing geometry data
-    glDrawElements(GL_TRIANGLES, m_triangleIndices.size(), GL_UNSIGNED_INT, (void *)0);
+    return error;
+}
+
+void Mesh::setVertexDecodeUniforms(const SceneProgram &program) const
+{
+    program.posOffset.set(m_posOffset);
+    program.posScale.set(m_posScale);
+    program.octScale.set(m_octScale);
+    program.uvOffset.set(m_uvOffset);
+    program.uvScale.set(m_uvScale);
+}
+
+void Mesh::bindVertexAttributes() const
+{
+    if (m_proceduralResolution > 0)
+        return;
+    if (m_layout == VertexLayout::External)
+    {
+        for (GLuint location = 0; location < 3; ++location)
+        {
+            const VertexAttribute &a = m_externalAttributes[location];
+            if (a.buffer == 0)
+            {
+                glDisableVertexAttribArray(location);
+                continue;
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, a.buffer);
+            glVertexAttribPointer(location, a.components, a.type, a.normalized, a.stride, (void *)a.offset);
+            glEnableVertexAttribArray(location);
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+        return;
+    }
+    if (m_layout == VertexLayout::QuantizedOct8)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_FALSE, sizeof(QuantizedVertex8), (void *)offsetof(QuantizedVertex8, position));
+        glVertexAttribPointer(1, 2, GL_BYTE, GL_FALSE, sizeof(QuantizedVertex8), (void *)offsetof(QuantizedVertex8, normal));
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex8), (void *)offsetof(QuantizedVertex8, texCoord));
+    }
+    else if (m_layout == VertexLayout::QuantizedOct16)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_FALSE, sizeof(QuantizedVertex16), (void *)offsetof(QuantizedVertex16, position));
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(QuantizedVertex16), (void *)offsetof(QuantizedVertex16, normal));
+        glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex16), (void *)offsetof(QuantizedVertex16, texCoord));
+    }
+    else if (m_layout == VertexLayout::Interleaved)
+    {
+        // same buffer for every attribute, only the offset inside a Vertex changes
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, texCoord));
+    }
+    else
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_posVbo);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
+        glBindBuffer(GL_ARRAY_BUFFER, m_normalVbo);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
+        glBindBuffer(GL_ARRAY_BUFFER, m_texCoordVbo);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), 0);
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo); // the index buffer binding is part of the VAO state too
+}
+
+void Mesh::drawElements(const GLsizei instanceCount) const
+{
+    if (m_proceduralResolution > 0)
+    {
+        // two triangles per quad of the grid, degenerate at the poles
+        const GLsizei vertexCount = 6 * m_proceduralResolution * m_proceduralResolution;
+        glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount, instanceCount);
+        return;
+    }
+    // primitive restart is only enabled around the meshes with strip ends: the other draws skip the state changes
+    if (m_primitiveRestart)
+    {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(maxIndex(m_indexType));
+    }
+    if (m_ibo == 0)
+        glDrawArraysInstanced(m_primitive, 0, m_vertexCount, instanceCount);
+    else if (instanceCount == 1)
+        glDrawElements(m_primitive, m_indexCount, m_indexType, (void *)m_indexOffset);
+    else
+        glDrawElementsInstanced(m_primitive, m_indexCount, m_indexType, (void *)m_indexOffset, instanceCount);
+    if (m_primitiveRestart)
+        glDisable(GL_PRIMITIVE_RESTART);
+}
+
+const SceneProgram &Mesh::program(const Material &material) const
+{
+    // procedural spheres have no vertex buffer: their own variant rebuilds the vertices from gl_VertexID
+    if (m_proceduralResolution > 0)
+        return g_proceduralProgram;
+    return material.program ? *material.program : g_program;
+}
+
+void Mesh::render(const glm::mat4 &model, const MaterialHandle materialHandle, const GLuint pickId)
+{
+    const Material &material = g_materials.get(materialHandle);
+    const SceneProgram &program = this->program(material);
+    program.use();
+    // glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Erase the color and z buffers.
+    setVertexDecodeUniforms(program);
+    if (m_proceduralResolution > 0)
+        program.sphereResolution.set((int)m_proceduralResolution);
+    program.modelMat.set(model); // pass the model matrix to the GPU program
+    program.pickId.set(pickId);
+    material.apply(program); // binds that match the current state are skipped by g_glState
+    g_glState.bindVertexArray(m_vao); // activate the VAO storing geometry data
+    drawElements(1);
 };
 
-std::shared_ptr<Mesh> Mesh::genSphere(const size_t resolution)
+// Same geometry as m_vao, plus the per-instance attributes stepped once per instance
+void Mesh::initInstanceArray()
+{
+    glGenVertexArrays(1, &m_instanceVao);
+    g_glState.bindVertexArray(m_instanceVao);
+    bindVertexAttributes();
+    glGenBuffers(1, &m_instanceVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    // a mat4 attribute takes four consecutive locations, one per column
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribDivisor(3 + column, 1);
+    }
+    glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, lColor));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+    glVertexAttribPointer(8, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, emission));
+    glEnableVertexAttribArray(8);
+    glVertexAttribDivisor(8, 1);
+    glVertexAttribPointer(9, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)offsetof(InstanceData, albedoLayer));
+    glEnableVertexAttribArray(9);
+    glVertexAttribDivisor(9, 1);
+    g_glState.bindVertexArray(0);
+}
+
+void Mesh::renderInstanced(const InstanceData *instances, const size_t count, const MaterialHandle materialHandle,
+                           const GLuint firstPickId)
+{
+    if (count == 0 || m_vao == 0 || m_proceduralResolution > 0)
+        return;
+    if (m_instanceVao == 0)
+        initInstanceArray();
+
+    // the buffer is only reallocated when it grows, at least doubling; otherwise the instances overwrite its start
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    if (count > m_instanceCapacity)
+    {
+        m_instanceCapacity = std::max(count, 2 * m_instanceCapacity);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * m_instanceCapacity, nullptr, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstanceData) * count, instances);
+
+    g_instancedProgram.use();
+    setVertexDecodeUniforms(g_instancedProgram);
+    g_instancedProgram.pickId.set(firstPickId);
+    g_materials.get(materialHandle).apply(g_instancedProgram); // only its texture array: the rest is per instance
+    g_glState.bindVertexArray(m_instanceVao);
+    drawElements(count);
+}
+
+namespace
+{
+// Runs func(begin, end) on contiguous chunks of [0, count) spread over threadCount threads (0: one per core)
+template <typename Func>
+void parallelFor(const size_t count, size_t threadCount, const size_t minChunk, Func func)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, std::max<size_t>(1, count / minChunk));
+    if (threadCount <= 1)
+    {
+        func(0, count);
+        return;
+    }
+    std::vector<std::thread> threads;
+    const size_t chunk = (count + threadCount - 1) / threadCount;
+    for (size_t begin = 0; begin < count; begin += chunk)
+        threads.push_back(std::thread(func, begin, std::min(begin + chunk, count)));
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+}
+
+// One row of genSphere: count vertices at the height z, on the circle of radius xy. The outputs and the column
+// tables are non-aliasing spans, so that GCC vectorizes the loop with its interleaved stores (-fopt-info-vec)
+void fillSphereRow(float *__restrict p, float *__restrict n, float *__restrict uv, const float *__restrict cosSector,
+                   const float *__restrict sinSector, const float *__restrict sCoord, const float xy, const float z,
+                   const float t, const size_t count)
+{
+    for (size_t j = 0; j < count; ++j)
+    {
+        const float x = xy * cosSector[j]; // r * cos(u) * cos(v)
+        const float y = xy * sinSector[j]; // r * cos(u) * sin(v)
+        p[3 * j] = x;
+        p[3 * j + 1] = y;
+        p[3 * j + 2] = z;
+        n[3 * j] = x; // unit sphere: the normal is the position
+        n[3 * j + 1] = y;
+        n[3 * j + 2] = z;
+        uv[2 * j] = sCoord[j];
+        uv[2 * j + 1] = t;
+    }
+}
+} // namespace
+
+std::shared_ptr<Mesh> Mesh::genSphere(const size_t resolution, const size_t threadCount)
 {
     std::shared_ptr<Mesh> meshPtr = std::make_shared<Mesh>();
-    int sector = resolution; // horizontal (longitude)
-    int stack = resolution;  // vertical (latitude)
-    int radius = 1;          // unit sphere;
-    float s, t;              // texCoords
-    float sectorStep = 2 * M_PI / sector;
-    float stackStep = M_PI / stack;
-    float stackAngle, sectorAngle;
-    // Generate positions and normals
-    for (int i = 0; i <= stack; ++i)
-    {
-        // std::cout << "i is " << i << std::endl;
-        stackAngle = M_PI / 2 - i * stackStep; // starting from pi/2 to -pi/2
-        float xy = radius * cosf(stackAngle);  // r * cos(u)
-        float z = radius * sinf(stackAngle);   // r * sin(u)
-        for (int j = 0; j <= sector; ++j)
+    const size_t sector = resolution; // horizontal (longitude)
+    const size_t stack = resolution;  // vertical (latitude)
+    const size_t rowSize = sector + 1;
+    const size_t vertexCount = (stack + 1) * rowSize;
+    const double sectorStep = 2 * M_PI / sector;
+    const double stackStep = M_PI / stack;
+
+    // exact sizes: no reallocation while filling, and each thread writes its own rows in place. The arrays are not
+    // zeroed (UninitializedAllocator): their pages are first touched by the threads that fill them
+    FloatArray &positions = meshPtr->m_vertexPositions;
+    FloatArray &normals = meshPtr->m_vertexNormals;
+    FloatArray &texCoords = meshPtr->m_vertexTexCoords;
+    positions.resize(3 * vertexCount);
+    normals.resize(3 * vertexCount);
+    texCoords.resize(2 * vertexCount);
+
+    // sines and cosines only depend on the row or on the column: tabulate them once
+    std::vector<float> cosSector(rowSize), sinSector(rowSize), sCoord(rowSize);
+    for (size_t j = 0; j <= sector; ++j)
+    {
+        const double sectorAngle = j * sectorStep; // starting from 0 to 2pi
+        cosSector[j] = (float)cos(sectorAngle);
+        sinSector[j] = (float)sin(sectorAngle);
+        sCoord[j] = (float)j / sector;
+    }
+
+    // Generate positions, normals and texCoords, one row (stack) at a time
+    parallelFor(stack + 1, threadCount, 64, [&](size_t rowBegin, size_t rowEnd) {
+        for (size_t i = rowBegin; i < rowEnd; ++i)
         {
-            sectorAngle = j * sectorStep; // starting from 0 to 2pi
-
-            float x = xy * cosf(sectorAngle); // r * cos(u) * cos(v)
-            float y = xy * sinf(sectorAngle); // r * cos(u) * sin(v)
-            meshPtr->m_vertexPositions.push_back(x);
-            meshPtr->m_vertexPositions.push_back(y);
-            meshPtr->m_vertexPositions.push_back(z);
-            glm::vec3 normal = glm::normalize(glm::vec3(x, y, z));
-            meshPtr->m_vertexNormals.push_back(normal.x);
-            meshPtr->m_vertexNormals.push_back(normal.y);
-            meshPtr->m_vertexNormals.push_back(normal.z);
-
-            s = (float)j / sector;
-            t = (float)i / stack;
-            meshPtr->m_vertexTexCoords.push_back(s);
-            meshPtr->m_vertexTexCoords.push_back(t);
+            const double stackAngle = M_PI / 2 - i * stackStep; // starting from pi/2 to -pi/2
+            const float xy = (float)cos(stackAngle);            // r * cos(u)
+            const float z = (float)sin(stackAngle);             // r * sin(u)
+            const float t = (float)i / stack;
+            fillSphereRow(&positions[3 * i * rowSize], &normals[3 * i * rowSize], &texCoords[2 * i * rowSize], cosSector.data(),
+                          sinSector.data(), sCoord.data(), xy, z, t, rowSize);
         }
-    }
+    });
 
     // generate CCW index list of sphere triangles
     // k1--k1+1
     // |  / |
     // | /  |
     // k2--k2+1
-    int k1, k2;
-    for (int i = 0; i < stack; ++i)
+    // 2 triangles per sector excluding first and last stacks, so the first index of a stack is known in advance
+    IndexArray &indices = meshPtr->m_triangleIndices;
+    indices.resize(stack > 1 ? 6 * sector * (stack - 1) : 0);
+    parallelFor(stack, threadCount, 64, [&](size_t rowBegin, size_t rowEnd) {
+        for (size_t i = rowBegin; i < rowEnd; ++i)
+        {
+            unsigned int *out = indices.data() + (i == 0 ? 0 : 3 * sector + 6 * sector * (i - 1));
+            unsigned int k1 = i * rowSize; // beginning of current stack
+            unsigned int k2 = k1 + rowSize; // beginning of next stack
+            for (size_t j = 0; j < sector; ++j, ++k1, ++k2)
+            {
+                // k1 => k2 => k1+1
+                if (i != 0)
+                {
+                    *out++ = k1;
+                    *out++ = k2;
+                    *out++ = k1 + 1;
+                }
+                // k1+1 => k2 => k2+1
+                if (i != (stack - 1))
+                {
+                    *out++ = k1 + 1;
+                    *out++ = k2;
+                    *out++ = k2 + 1;
+                }
+            }
+        }
+    });
+    meshPtr->setUnitSphereBounds();
+    return meshPtr;
+};
+
+std::shared_ptr<Mesh> Mesh::fromBuffers(const VertexAttribute attributes[3], const GLsizei vertexCount,
+                                        const GLuint indexBuffer, const GLenum indexType, const GLsizei indexCount,
+                                        const size_t indexOffset, const GLenum primitive, const Aabb &bounds)
+{
+    std::shared_ptr<Mesh> meshPtr = std::make_shared<Mesh>();
+    meshPtr->m_layout = VertexLayout::External;
+    for (int i = 0; i < 3; ++i)
+        meshPtr->m_externalAttributes[i] = attributes[i];
+    meshPtr->m_vertexCount = vertexCount;
+    meshPtr->m_ibo = indexBuffer;
+    meshPtr->m_indexType = indexType;
+    meshPtr->m_indexCount = indexCount;
+    meshPtr->m_indexOffset = indexOffset;
+    meshPtr->m_primitive = primitive;
+    meshPtr->m_bounds = bounds;
+    meshPtr->m_boundingSphere = boundingSphereOf(bounds);
+    glGenVertexArrays(1, &meshPtr->m_vao);
+    g_glState.bindVertexArray(meshPtr->m_vao);
+    meshPtr->bindVertexAttributes();
+    g_glState.bindVertexArray(0);
+    return meshPtr;
+}
+
+std::shared_ptr<Mesh> Mesh::fromArrays(const float *positions, const float *normals, const float *texCoords,
+                                       const size_t vertexCount, const unsigned int *indices, const size_t indexCount,
+                                       const GLenum primitive)
+{
+    std::shared_ptr<Mesh> meshPtr = std::make_shared<Mesh>();
+    meshPtr->m_vertexPositions.assign(positions, positions + 3 * vertexCount);
+    meshPtr->m_vertexNormals.assign(normals, normals + 3 * vertexCount);
+    meshPtr->m_vertexTexCoords.assign(texCoords, texCoords + 2 * vertexCount);
+    meshPtr->m_triangleIndices.assign(indices, indices + indexCount);
+    meshPtr->m_primitive = primitive;
+    return meshPtr;
+}
+
+std::shared_ptr<Mesh> Mesh::genProceduralSphere(const size_t resolution)
+{
+    std::shared_ptr<Mesh> meshPtr = std::make_shared<Mesh>();
+    meshPtr->m_proceduralResolution = resolution;
+    meshPtr->setUnitSphereBounds();
+    return meshPtr;
+}
+
+std::shared_ptr<Mesh> Mesh::genSphereStrip(const size_t resolution)
+{
+    std::shared_ptr<Mesh> meshPtr = genSphere(resolution); // same vertices, only the indices change
+    meshPtr->m_primitive = GL_TRIANGLE_STRIP;
+    IndexArray &indices = meshPtr->m_triangleIndices;
+    indices.clear();
+    indices.reserve(resolution * (2 * (resolution + 1) + 1));
+    // k1, k2, k1+1, k2+1, ... gives the same CCW triangles as the list; the pole
+    // stacks add degenerate triangles, dropped by the rasterizer
+    for (size_t i = 0; i < resolution; ++i)
     {
-        k1 = i * (sector + 1); // beginning of current stack
-        k2 = k1 + sector + 1;  // beginning of next stack
+        const unsigned int k1 = i * (resolution + 1); // beginning of current stack
+        const unsigned int k2 = k1 + resolution + 1;  // beginning of next stack
+        for (size_t j = 0; j <= resolution; ++j)
+        {
+            indices.push_back(k1 + j);
+            indices.push_back(k2 + j);
+        }
+        indices.push_back(kRestartIndex);
+    }
+    return meshPtr;
+}
+
+namespace
+{
+// Texture coordinates of a point of the unit sphere, with the same mapping as genSphere (z is the pole)
+glm::vec2 sphericalTexCoord(const glm::vec3 &p)
+{
+    float s = atan2f(p.y, p.x) / (2 * M_PI);
+    if (s < 0)
+        s += 1;
+    const float t = acosf(glm::clamp(p.z, -1.0f, 1.0f)) / M_PI;
+    return glm::vec2(s, t);
+}
+
+// Fills the attribute arrays of a unit sphere given its positions and CCW triangles.
+// Normals are the positions and texture coordinates use the longitude/latitude mapping.
+// Vertices are duplicated along the seam (s wraps from 1 to 0) and at the poles (s is undefined)
+// so that no triangle interpolates its texture coordinates across the wrap.
+void fillSphereAttributes(const std::vector<glm::vec3> &points, const std::vector<unsigned int> &triangles,
+                          FloatArray &positions, FloatArray &normals, FloatArray &texCoords, IndexArray &indices)
+{
+    std::vector<glm::vec2> uvs(points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+        uvs[i] = sphericalTexCoord(points[i]);
 
-        for (int j = 0; j < sector; ++j, ++k1, ++k2)
+    std::map<std::pair<unsigned int, float>, unsigned int> copies; // (point, s) -> output vertex
+    indices.reserve(triangles.size());
+    for (size_t tri = 0; tri < triangles.size(); tri += 3)
+    {
+        float s[3];
+        bool pole[3];
+        float sMin = 1, sMax = 0, sSum = 0;
+        int nonPole = 0;
+        for (int k = 0; k < 3; ++k)
         {
-            // 2 triangles per sector excluding first and last stacks
-            // k1 => k2 => k1+1
-            if (i != 0)
+            const unsigned int v = triangles[tri + k];
+            s[k] = uvs[v].x;
+            pole[k] = fabsf(points[v].z) > 1 - 1e-6f;
+            if (!pole[k])
             {
-                meshPtr->m_triangleIndices.push_back(k1);
-                meshPtr->m_triangleIndices.push_back(k2);
-                meshPtr->m_triangleIndices.push_back(k1 + 1);
+                sMin = std::min(sMin, s[k]);
+                sMax = std::max(sMax, s[k]);
             }
+        }
+        for (int k = 0; k < 3; ++k)
+        {
+            if (pole[k])
+                continue;
+            if (sMax - sMin > 0.5f && s[k] < 0.5f)
+                s[k] += 1; // triangle across the seam: continue past 1 instead of wrapping to 0
+            sSum += s[k];
+            ++nonPole;
+        }
+        for (int k = 0; k < 3; ++k)
+        {
+            if (pole[k])
+                s[k] = nonPole > 0 ? sSum / nonPole : 0.5f;
 
-            // k1+1 => k2 => k2+1
-            if (i != (stack - 1))
+            const unsigned int v = triangles[tri + k];
+            const std::pair<unsigned int, float> key(v, s[k]);
+            std::map<std::pair<unsigned int, float>, unsigned int>::iterator it = copies.find(key);
+            if (it == copies.end())
             {
-                meshPtr->m_triangleIndices.push_back(k1 + 1);
-                meshPtr->m_triangleIndices.push_back(k2);
-                meshPtr->m_triangleIndices.push_back(k2 + 1);
+                it = copies.insert(std::make_pair(key, (unsigned int)(positions.size() / 3))).first;
+                const glm::vec3 &p = points[v];
+                positions.push_back(p.x);
+                positions.push_back(p.y);
+                positions.push_back(p.z);
+                normals.push_back(p.x);
+                normals.push_back(p.y);
+                normals.push_back(p.z);
+                texCoords.push_back(s[k]);
+                texCoords.push_back(uvs[v].y);
             }
+            indices.push_back(it->second);
         }
     }
+}
+} // namespace
+
+std::shared_ptr<Mesh> Mesh::genIcosphere(const size_t subdivisions)
+{
+    // regular icosahedron
+    const float t = (1.0f + sqrtf(5.0f)) / 2.0f;
+    std::vector<glm::vec3> points = {
+        {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+        {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+        {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+    for (size_t i = 0; i < points.size(); ++i)
+        points[i] = glm::normalize(points[i]);
+    std::vector<unsigned int> triangles = {
+        0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+        1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+        3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+        4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1};
+
+    // split every triangle in four, sharing the edge midpoints between neighbors
+    for (size_t level = 0; level < subdivisions; ++level)
+    {
+        std::map<std::pair<unsigned int, unsigned int>, unsigned int> midpoints;
+        std::vector<unsigned int> refined;
+        refined.reserve(triangles.size() * 4);
+        for (size_t tri = 0; tri < triangles.size(); tri += 3)
+        {
+            unsigned int mid[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                const unsigned int a = triangles[tri + k];
+                const unsigned int b = triangles[tri + (k + 1) % 3];
+                const std::pair<unsigned int, unsigned int> edge(std::min(a, b), std::max(a, b));
+                std::map<std::pair<unsigned int, unsigned int>, unsigned int>::iterator it = midpoints.find(edge);
+                if (it == midpoints.end())
+                {
+                    it = midpoints.insert(std::make_pair(edge, (unsigned int)points.size())).first;
+                    points.push_back(glm::normalize(points[a] + points[b]));
+                }
+                mid[k] = it->second; // mid[k] lies on the edge (k, k+1)
+            }
+            const unsigned int a = triangles[tri], b = triangles[tri + 1], c = triangles[tri + 2];
+            const unsigned int children[12] = {a, mid[0], mid[2], b, mid[1], mid[0], c, mid[2], mid[1], mid[0], mid[1], mid[2]};
+            refined.insert(refined.end(), children, children + 12);
+        }
+        triangles.swap(refined);
+    }
+
+    std::shared_ptr<Mesh> meshPtr = std::make_shared<Mesh>();
+    fillSphereAttributes(points, triangles, meshPtr->m_vertexPositions, meshPtr->m_vertexNormals,
+                         meshPtr->m_vertexTexCoords, meshPtr->m_triangleIndices);
+    meshPtr->setUnitSphereBounds();
     return meshPtr;
-};
+}
+
+std::shared_ptr<Mesh> Mesh::genCubeSphere(const size_t resolution)
+{
+    // each face: its normal n and two axes (u, v) with cross(u, v) = n so that the triangles are CCW
+    const glm::ivec3 faces[6][3] = {
+        {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+        {{0, 1, 0}, {0, 0, 1}, {1, 0, 0}}, {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+        {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}}, {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}}};
+    const int res = (int)resolution;
+
+    // grid points are identified by integer coordinates on the cube [-res, res]^3,
+    // so that the points of an edge shared by two faces are welded exactly
+    std::map<std::pair<int, std::pair<int, int>>, unsigned int> welded;
+    std::vector<glm::vec3> points;
+    std::vector<unsigned int> grid((res + 1) * (res + 1));
+    std::vector<unsigned int> triangles;
+    triangles.reserve(6 * 6 * res * res);
+    for (int f = 0; f < 6; ++f)
+    {
+        const glm::ivec3 &n = faces[f][0], &u = faces[f][1], &v = faces[f][2];
+        for (int j = 0; j <= res; ++j)
+        {
+            for (int i = 0; i <= res; ++i)
+            {
+                const glm::ivec3 c = res * n + (2 * i - res) * u + (2 * j - res) * v;
+                const std::pair<int, std::pair<int, int>> key(c.x, std::make_pair(c.y, c.z));
+                std::map<std::pair<int, std::pair<int, int>>, unsigned int>::iterator it = welded.find(key);
+                if (it == welded.end())
+                {
+                    it = welded.insert(std::make_pair(key, (unsigned int)points.size())).first;
+                    // spherified cube: more uniform cells than normalizing the cube point
+                    const glm::vec3 p = glm::vec3(c) / (float)res;
+                    const glm::vec3 p2 = p * p;
+                    points.push_back(glm::normalize(glm::vec3(
+                        p.x * sqrtf(1 - p2.y / 2 - p2.z / 2 + p2.y * p2.z / 3),
+                        p.y * sqrtf(1 - p2.z / 2 - p2.x / 2 + p2.z * p2.x / 3),
+                        p.z * sqrtf(1 - p2.x / 2 - p2.y / 2 + p2.x * p2.y / 3))));
+                }
+                grid[j * (res + 1) + i] = it->second;
+            }
+        }
+        for (int j = 0; j < res; ++j)
+        {
+            for (int i = 0; i < res; ++i)
+            {
+                const unsigned int k00 = grid[j * (res + 1) + i], k10 = grid[j * (res + 1) + i + 1];
+                const unsigned int k01 = grid[(j + 1) * (res + 1) + i], k11 = grid[(j + 1) * (res + 1) + i + 1];
+                const unsigned int quad[6] = {k00, k10, k11, k00, k11, k01};
+                triangles.insert(triangles.end(), quad, quad + 6);
+            }
+        }
+    }
+
+    std::shared_ptr<Mesh> meshPtr = std::make_shared<Mesh>();
+    fillSphereAttributes(points, triangles, meshPtr->m_vertexPositions, meshPtr->m_vertexNormals,
+                         meshPtr->m_vertexTexCoords, meshPtr->m_triangleIndices);
+    meshPtr->setUnitSphereBounds();
+    return meshPtr;
+}
@@ -5,31 +5,199 @@
 #include <memory>
 #include <glm/glm.hpp>
 #include <glad/gl.h>
+#include "bounds.h"
+#include "shaderprogram.h"
+#include "material.h"
+#include "meshdata.h"
 
-// Forward declare camera & global program if needed
-extern GLuint g_program;
-extern class Camera g_camera;
+// Programs render() and renderInstanced() draw with, defined in globals.cpp
+extern SceneProgram g_program;
+extern SceneProgram g_instancedProgram;  // vertex shader compiled with INSTANCED
+extern SceneProgram g_proceduralProgram; // vertex shader compiled with PROCEDURAL_SPHERE
+
+// One vertex of the interleaved layout: all attributes of a vertex are contiguous in memory
+struct Vertex
+{
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec2 texCoord;
+};
+
+// Vertices of the quantized layouts, decoded by the vertex shader (see setVertexDecodeUniforms):
+// positions are snorm16 in the mesh bounds, normals are octahedral-encoded, texcoords are unorm16 in the texcoord
+// bounds (which may exceed [0, 1], e.g. the seam triangles of the subdivided spheres)
+struct QuantizedVertex8 // 12 bytes
+{
+  GLshort position[3];
+  GLbyte normal[2]; // snorm8 octahedral
+  GLushort texCoord[2];
+};
+
+struct QuantizedVertex16 // 16 bytes
+{
+  GLshort position[4]; // w unused, keeps the normal 4-byte aligned
+  GLshort normal[2];   // snorm16 octahedral
+  GLushort texCoord[2];
+};
+
+// Largest error introduced by a quantized layout, compared to the float attributes
+struct QuantizationError
+{
+  float position;      // in object space units
+  float normalDegrees; // angle between the decoded and the original normal
+  float texCoord;
+  glm::vec2 texCoordMin, texCoordMax; // range of the texcoords: outside [0, 1] (seams) is remapped, not clamped
+};
+
+// Vertex attribute read from a GPU buffer owned elsewhere (e.g., by a GlbModel), see Mesh::fromBuffers()
+struct VertexAttribute
+{
+  GLuint buffer;        // 0 if the attribute is absent
+  GLint components;
+  GLenum type;          // GL_FLOAT, GL_UNSIGNED_SHORT, ...
+  GLboolean normalized;
+  GLsizei stride;       // 0 when tightly packed
+  size_t offset;        // in bytes, from the start of the buffer
+};
+
+// Per-instance data of Mesh::renderInstanced(), read by the INSTANCED vertex shader
+struct InstanceData
+{
+  glm::mat4 model;
+  glm::vec3 lColor;
+  glm::vec3 emission;
+  float albedoLayer; // in the texture array of the material: instances with different maps share the draw
+};
+
+// How the vertex attributes are stored on the GPU
+enum class VertexLayout
+{
+  Interleaved,    // a single VBO holding an array of Vertex
+  Split,          // one VBO per attribute (positions, normals, texcoords)
+  QuantizedOct8,  // a single VBO holding an array of QuantizedVertex8
+  QuantizedOct16, // a single VBO holding an array of QuantizedVertex16
+  External        // attributes described by VertexAttribute, in buffers the mesh does not own
+};
+
+// What init() keeps of the CPU-side geometry once it is on the GPU
+enum class RetentionPolicy
+{
+  Keep,            // everything (e.g., for picking or re-uploading)
+  DropAfterUpload, // nothing, not even the bounds: the mesh only knows its GPU buffers and counts
+  KeepBounds       // the bounds (computed first if unknown) and the counts only
+};
 
 // Class that defines the attributes of a mesh
 class Mesh
 {
 public: 
-  std::vector<unsigned int> getIndices() const;
+  // CPU-side geometry, empty once dropped by init() (see RetentionPolicy)
+  const IndexArray &getIndices() const;
+  const FloatArray &getPositions() const; // [x0, y0, z0, x1, y1, z1, ...]
+  const FloatArray &getNormals() const;
+  const FloatArray &getTexCoords() const; // [u0, v0, u1, v1, ...]
+  GLenum getPrimitive() const;
+  // Variant of the shaders render() draws with for this material
+  const SceneProgram &program(const Material &material) const;
+  size_t vertexCount() const;
+  size_t indexCount() const;
+  // Object space bounds: analytic for the generated spheres, from the accessors for glTF meshes,
+  // otherwise computed by init(); empty after init() with DropAfterUpload
+  const Aabb &bounds() const;
+  const BoundingSphere &boundingSphere() const;
+  size_t cpuBytes() const; // held by the CPU-side vectors
+  size_t gpuBytes() const; // of the buffers owned by this mesh (not those of fromBuffers())
   Mesh() = default;
-  void init();
-  void render(const glm::mat4 &model, const glm::vec3 &lColor, const glm::vec3 &emission, GLuint texture, std::string planet);
-  static std::shared_ptr<Mesh> genSphere(const size_t resolution = 16);
+  // Deletes the GL objects created by init()
+  ~Mesh();
+  // A copy would delete the GL objects twice: use clone() instead
+  Mesh(const Mesh &) = delete;
+  Mesh &operator=(const Mesh &) = delete;
+  // Copy of the CPU-side geometry and bounds, without any GL object: nullptr once init() has been called
+  std::shared_ptr<Mesh> clone() const;
+  // Marks the end of a strip in the CPU-side indices, replaced by the maximum value of the GPU index type;
+  // only the meshes holding it are drawn with primitive restart
+  static const unsigned int kRestartIndex = ~0u;
+
+  // Reorders the triangles and vertices for the GPU caches (see meshopt.h), before init(); triangle lists only
+  void optimize();
+  void init(const VertexLayout layout = VertexLayout::Interleaved, const RetentionPolicy retention = RetentionPolicy::Keep);
+  // pickId: written to the IdBuffer when drawing into it (0 for none)
+  void render(const glm::mat4 &model, const MaterialHandle material, const GLuint pickId = 0);
+  // Draws count instances with a single glDrawElementsInstanced: their model matrices, colors and albedo layers
+  // come from instances, the texture array from material. Instance i is written as firstPickId + i to the IdBuffer. The first call
+  // creates a VAO of its own, so the one of render() is left as is. Not for the procedural spheres.
+  void renderInstanced(const InstanceData *instances, const size_t count, const MaterialHandle material,
+                       const GLuint firstPickId = 0);
+  // Binds the mesh buffers and sets attributes 0 to 2 on the currently bound VAO,
+  // so that other VAOs (e.g., with their own instance attributes) can draw this geometry
+  void bindVertexAttributes() const;
+  // Issues the draw call for the currently bound VAO
+  void drawElements(const GLsizei instanceCount) const;
+  // Uniforms decoding the vertex attributes of this mesh (identity for the float layouts)
+  void setVertexDecodeUniforms(const SceneProgram &program) const;
+  // Precision lost by storing this mesh with a quantized layout
+  QuantizationError quantizationError(const VertexLayout layout) const;
+  // UV sphere with resolution sectors and stacks; rows are split over threadCount threads (0: one per core)
+  static std::shared_ptr<Mesh> genSphere(const size_t resolution = 16, const size_t threadCount = 0);
+  // Mesh drawing attributes 0 to 2 (position, normal, texcoord) and the indices straight from existing GPU buffers.
+  // indexBuffer 0 draws vertexCount vertices without indices. Needs a GL context; init() must not be called.
+  static std::shared_ptr<Mesh> fromBuffers(const VertexAttribute attributes[3], const GLsizei vertexCount,
+                                           const GLuint indexBuffer, const GLenum indexType, const GLsizei indexCount,
+                                           const size_t indexOffset, const GLenum primitive = GL_TRIANGLES,
+                                           const Aabb &bounds = Aabb());
+  // Mesh from the arrays of an already generated (and optimized) mesh, e.g., cooked into an AssetArchive; init() uploads it
+  static std::shared_ptr<Mesh> fromArrays(const float *positions, const float *normals, const float *texCoords,
+                                          const size_t vertexCount, const unsigned int *indices, const size_t indexCount,
+                                          const GLenum primitive = GL_TRIANGLES);
+  // Same sphere as genSphere, but without any vertex or index data: the vertex shader rebuilds it from gl_VertexID.
+  // Only render() supports it.
+  static std::shared_ptr<Mesh> genProceduralSphere(const size_t resolution = 16);
+  // Same vertices as genSphere, indexed as one triangle strip per stack separated by kRestartIndex
+  static std::shared_ptr<Mesh> genSphereStrip(const size_t resolution = 16);
+  // Unit sphere from a recursively subdivided icosahedron: nearly uniform triangles, 20 * 4^subdivisions of them
+  static std::shared_ptr<Mesh> genIcosphere(const size_t subdivisions = 3);
+  // Unit sphere from a subdivided cube projected on the sphere: resolution^2 quads per face
+  static std::shared_ptr<Mesh> genCubeSphere(const size_t resolution = 8);
 
 private:
-  std::vector<float> m_vertexPositions;
-  std::vector<float> m_vertexNormals;
-  std::vector<unsigned int> m_triangleIndices;
-  std::vector<float> m_vertexTexCoords;
+  void setUnitSphereBounds();
+  void initInterleavedBuffers();
+  void initSplitBuffers();
+  void initQuantizedBuffers();
+  void initIndexBuffer();
+  void initInstanceArray();
+
+  FloatArray m_vertexPositions;
+  FloatArray m_vertexNormals;
+  IndexArray m_triangleIndices;
+  FloatArray m_vertexTexCoords;
+  VertexLayout m_layout = VertexLayout::Interleaved;
+  glm::vec3 m_posOffset = glm::vec3(0.0f); // position = m_posOffset + m_posScale * attribute
+  glm::vec3 m_posScale = glm::vec3(1.0f);
+  float m_octScale = 0.0f; // octahedral normal = attribute * m_octScale, 0 for float normals
+  glm::vec2 m_uvOffset = glm::vec2(0.0f); // texcoord = m_uvOffset + m_uvScale * attribute
+  glm::vec2 m_uvScale = glm::vec2(1.0f);
+  size_t m_proceduralResolution = 0; // > 0 for the attribute-less spheres of genProceduralSphere
+  GLenum m_primitive = GL_TRIANGLES;    // or GL_TRIANGLE_STRIP with primitive restart
+  GLenum m_indexType = GL_UNSIGNED_INT; // GL_UNSIGNED_SHORT when every vertex index fits, chosen by init()
+  bool m_primitiveRestart = false;      // the indices hold kRestartIndex: drawn with primitive restart
+  GLsizei m_indexCount = 0;
+  size_t m_indexOffset = 0;           // in bytes, in the index buffer
+  GLsizei m_vertexCount = 0;          // for meshes drawn without indices
+  Aabb m_bounds;
+  BoundingSphere m_boundingSphere;
+  size_t m_gpuBytes = 0; // vertex and index buffers
+  VertexAttribute m_externalAttributes[3] = {}; // External layout only
   GLuint m_vao = 0;
+  GLuint m_vbo = 0; // interleaved layout
   GLuint m_posVbo = 0;
   GLuint m_normalVbo = 0;
   GLuint m_texCoordVbo = 0;
   GLuint m_ibo = 0;
+  GLuint m_instanceVao = 0;      // attributes of m_vao plus the instance attributes, see renderInstanced()
+  GLuint m_instanceVbo = 0;
+  size_t m_instanceCapacity = 0; // instances m_instanceVbo can hold, grown geometrically
 };
 
-#endif // MESH_H
\ No newline at end of file
+#endif // MESH_H
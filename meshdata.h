@@ -0,0 +1,32 @@
+#ifndef MESHDATA_H
+#define MESHDATA_H
+
+#include <vector>
+#include <memory>
+#include <utility>
+
+// std::allocator whose default construction leaves the values uninitialized: resize() of a large array only
+// allocates, and its pages are first touched by the code that fills them (e.g., the worker threads of
+// Mesh::genSphere) instead of being zeroed on the calling thread
+template <typename T>
+struct UninitializedAllocator : std::allocator<T>
+{
+  template <typename U>
+  struct rebind
+  {
+    typedef UninitializedAllocator<U> other;
+  };
+  UninitializedAllocator() {}
+  template <typename U>
+  UninitializedAllocator(const UninitializedAllocator<U> &) {}
+  template <typename U>
+  void construct(U *p) { ::new ((void *)p) U; }
+  template <typename U, typename... Args>
+  void construct(U *p, Args &&...args) { ::new ((void *)p) U(std::forward<Args>(args)...); }
+};
+
+// CPU-side arrays of a mesh
+typedef std::vector<float, UninitializedAllocator<float>> FloatArray;
+typedef std::vector<unsigned int, UninitializedAllocator<unsigned int>> IndexArray;
+
+#endif // MESHDATA_H
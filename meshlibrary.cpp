@@ -0,0 +1,121 @@
+#include "meshlibrary.h"
+#include <iostream>
+
+bool MeshKey::operator<(const MeshKey &other) const
+{
+    if (generator != other.generator)
+        return generator < other.generator;
+    return param < other.param;
+}
+
+MeshLibrary::MeshLibrary(const VertexLayout layout, const RetentionPolicy retention) : m_layout(layout), m_retention(retention) {}
+
+std::shared_ptr<Mesh> MeshLibrary::get(const MeshKey &key)
+{
+    std::map<MeshKey, std::shared_ptr<Mesh>>::iterator it = m_meshes.find(key);
+    if (it != m_meshes.end())
+        return it->second;
+
+    std::shared_ptr<Mesh> mesh = load(key);
+    if (!mesh)
+        mesh = cook(key);
+    if (m_layout == VertexLayout::QuantizedOct8 || m_layout == VertexLayout::QuantizedOct16)
+    {
+        const QuantizationError error = mesh->quantizationError(m_layout);
+        std::cout << "Quantized mesh (generator " << (int)key.generator << ", param " << key.param << "): max error position "
+                  << error.position << ", normal " << error.normalDegrees << " deg, texcoord " << error.texCoord << " (range [" << error.texCoordMin.x << ", "
+                  << error.texCoordMax.x << "] x [" << error.texCoordMin.y << ", " << error.texCoordMax.y << "])" << std::endl;
+    }
+    mesh->init(m_layout, m_retention);
+    m_meshes[key] = mesh;
+    return mesh;
+}
+
+std::shared_ptr<Mesh> MeshLibrary::getSphere(const size_t resolution)
+{
+    return get(MeshKey{MeshGenerator::Sphere, resolution});
+}
+
+std::shared_ptr<Mesh> MeshLibrary::getSphereStrip(const size_t resolution)
+{
+    return get(MeshKey{MeshGenerator::SphereStrip, resolution});
+}
+
+std::shared_ptr<Mesh> MeshLibrary::getIcosphere(const size_t subdivisions)
+{
+    return get(MeshKey{MeshGenerator::Icosphere, subdivisions});
+}
+
+std::shared_ptr<Mesh> MeshLibrary::getCubeSphere(const size_t resolution)
+{
+    return get(MeshKey{MeshGenerator::CubeSphere, resolution});
+}
+
+size_t MeshLibrary::size() const { return m_meshes.size(); }
+
+void MeshLibrary::clear() { m_meshes.clear(); }
+
+void MeshLibrary::printMemoryReport() const
+{
+    size_t cpuTotal = 0, gpuTotal = 0;
+    std::cout << "Mesh memory (generator, param: vertices, indices, CPU bytes, GPU bytes)" << std::endl;
+    for (std::map<MeshKey, std::shared_ptr<Mesh>>::const_iterator it = m_meshes.begin(); it != m_meshes.end(); ++it)
+    {
+        const Mesh &mesh = *it->second;
+        std::cout << "  " << (int)it->first.generator << ", " << it->first.param << ": " << mesh.vertexCount() << ", "
+                  << mesh.indexCount() << ", " << mesh.cpuBytes() << ", " << mesh.gpuBytes() << std::endl;
+        cpuTotal += mesh.cpuBytes();
+        gpuTotal += mesh.gpuBytes();
+    }
+    std::cout << "  total: " << m_meshes.size() << " meshes, " << cpuTotal << " CPU bytes, " << gpuTotal << " GPU bytes" << std::endl;
+}
+
+void MeshLibrary::setArchive(const std::shared_ptr<const AssetArchive> &archive) { m_archive = archive; }
+
+std::string MeshLibrary::assetName(const MeshKey &key)
+{
+    return "mesh/" + std::to_string((int)key.generator) + "/" + std::to_string(key.param);
+}
+
+uint64_t MeshLibrary::contentHash(const MeshKey &key)
+{
+    const uint64_t fields[3] = {kGeneratorVersion, (uint64_t)key.generator, (uint64_t)key.param};
+    return fnv1a(fields, sizeof(fields));
+}
+
+std::shared_ptr<Mesh> MeshLibrary::cook(const MeshKey &key)
+{
+    std::shared_ptr<Mesh> mesh = generate(key);
+    mesh->optimize();
+    return mesh;
+}
+
+std::shared_ptr<Mesh> MeshLibrary::load(const MeshKey &key) const
+{
+    const AssetEntry *entry = m_archive ? m_archive->find(assetName(key)) : nullptr;
+    if (!entry || entry->type != AssetType::Mesh || entry->contentHash != contentHash(key) || entry->size != (size_t)entry->vertexCount * 8 * sizeof(float) + (size_t)entry->indexCount * sizeof(unsigned int))
+        return nullptr;
+    const float *positions = (const float *)m_archive->data(*entry);
+    const float *normals = positions + 3 * entry->vertexCount;
+    const float *texCoords = normals + 3 * entry->vertexCount;
+    const unsigned int *indices = (const unsigned int *)(texCoords + 2 * entry->vertexCount);
+    return Mesh::fromArrays(positions, normals, texCoords, entry->vertexCount, indices, entry->indexCount, entry->primitive);
+}
+
+std::shared_ptr<Mesh> MeshLibrary::generate(const MeshKey &key)
+{
+    switch (key.generator)
+    {
+    case MeshGenerator::SphereStrip:
+        return Mesh::genSphereStrip(key.param);
+    case MeshGenerator::ProceduralSphere:
+        return Mesh::genProceduralSphere(key.param);
+    case MeshGenerator::Icosphere:
+        return Mesh::genIcosphere(key.param);
+    case MeshGenerator::CubeSphere:
+        return Mesh::genCubeSphere(key.param);
+    case MeshGenerator::Sphere:
+    default:
+        return Mesh::genSphere(key.param);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef MESHLIBRARY_H
+#define MESHLIBRARY_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include "mesh.h"
+#include "assetarchive.h"
+
+// Procedural generators known by the library
+enum class MeshGenerator
+{
+  Sphere,           // param: resolution
+  SphereStrip,      // param: resolution
+  ProceduralSphere, // param: resolution
+  Icosphere,        // param: subdivisions
+  CubeSphere        // param: resolution
+};
+
+// Identifies a generated geometry: the generator and its parameter (e.g., the sphere resolution)
+struct MeshKey
+{
+  MeshGenerator generator;
+  size_t param;
+
+  bool operator<(const MeshKey &other) const;
+};
+
+// Registry of generated meshes. Identical requests share the same Mesh so that
+// the geometry is generated and uploaded to the GPU only once.
+class MeshLibrary
+{
+public:
+  explicit MeshLibrary(const VertexLayout layout = VertexLayout::Interleaved,
+                       const RetentionPolicy retention = RetentionPolicy::Keep);
+
+  // Returns the shared mesh for this key, uploading it on first request (needs a GL context).
+  // The mesh is read from the archive when it holds it, generated and optimized otherwise.
+  std::shared_ptr<Mesh> get(const MeshKey &key);
+  std::shared_ptr<Mesh> getSphere(const size_t resolution = 16);
+  std::shared_ptr<Mesh> getSphereStrip(const size_t resolution = 16);
+  std::shared_ptr<Mesh> getIcosphere(const size_t subdivisions = 3);
+  std::shared_ptr<Mesh> getCubeSphere(const size_t resolution = 8);
+
+  size_t size() const; // number of distinct meshes held
+  void clear();
+  // CPU and GPU bytes of every mesh held, and their totals
+  void printMemoryReport() const;
+
+  // Cooked meshes to use instead of generating them (nullptr to always generate)
+  void setArchive(const std::shared_ptr<const AssetArchive> &archive);
+  // Version of the generators and of Mesh::optimize: bump it whenever they produce different geometry, so that the
+  // meshes cooked by an older version are cooked again (and ignored by load() until then)
+  static const uint32_t kGeneratorVersion = 2;
+  // Name of the mesh of this key in an AssetArchive
+  static std::string assetName(const MeshKey &key);
+  // Content hash of the cooked mesh of this key: the generator version, the generator and its parameter
+  static uint64_t contentHash(const MeshKey &key);
+  // Generated and optimized mesh, not uploaded: what get() uploads, and what the cookAssets tool stores
+  static std::shared_ptr<Mesh> cook(const MeshKey &key);
+
+private:
+  static std::shared_ptr<Mesh> generate(const MeshKey &key);
+  std::shared_ptr<Mesh> load(const MeshKey &key) const;
+
+  VertexLayout m_layout;
+  RetentionPolicy m_retention;
+  std::shared_ptr<const AssetArchive> m_archive;
+  std::map<MeshKey, std::shared_ptr<Mesh>> m_meshes;
+};
+
+#endif // MESHLIBRARY_H
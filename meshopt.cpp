@@ -0,0 +1,181 @@
+#include "meshopt.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+VertexCacheStats analyzeVertexCache(const IndexArray &indices, const size_t vertexCount, const size_t cacheSize)
+{
+    std::deque<unsigned int> cache;
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0, usedCount = 0;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        const unsigned int v = indices[i];
+        if (!used[v])
+        {
+            used[v] = true;
+            ++usedCount;
+        }
+        if (std::find(cache.begin(), cache.end(), v) != cache.end())
+            continue;
+        ++misses;
+        cache.push_back(v);
+        if (cache.size() > cacheSize)
+            cache.pop_front();
+    }
+    VertexCacheStats stats;
+    stats.acmr = indices.empty() ? 0 : (float)misses / (indices.size() / 3);
+    stats.atvr = usedCount == 0 ? 0 : (float)misses / usedCount;
+    return stats;
+}
+
+namespace
+{
+// Forsyth's scoring parameters; the simulated LRU cache is sized between the FIFO caches of the report
+const int kCacheSize = 24;
+const float kCacheDecayPower = 1.5f;
+const float kLastTriangleScore = 0.75f;
+const float kValenceBoostScale = 2.0f;
+const float kValenceBoostPower = 0.5f;
+
+// FIFO caches on which the new order must not be worse than the input one
+const size_t kFifoSizes[] = {16, 32};
+
+float vertexScore(const int cachePosition, const unsigned int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f; // no triangle left to draw with this vertex
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+            score = kLastTriangleScore; // used by the last triangle, fixed score whatever its exact position
+        else
+            score = powf(1.0f - (float)(cachePosition - 3) / (kCacheSize - 3), kCacheDecayPower);
+    }
+    // favor vertices with few triangles left so that they leave the working set early
+    return score + kValenceBoostScale * powf((float)remainingTriangles, -kValenceBoostPower);
+}
+} // namespace
+
+void optimizeVertexCache(IndexArray &indices, const size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles of every vertex, as a compact adjacency list
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < indices.size(); ++i)
+        ++remaining[indices[i]];
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        score[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<bool> emitted(triangleCount, false);
+    IndexArray result;
+    result.reserve(indices.size());
+    std::vector<unsigned int> cache, newCache;
+    size_t scanCursor = 0; // next candidate when the cache gives no triangle
+    int best = 0;
+    while (best >= 0)
+    {
+        emitted[best] = true;
+        const unsigned int *tri = &indices[3 * best];
+        result.insert(result.end(), tri, tri + 3);
+
+        // the emitted vertices move to the front of the cache, in triangle order
+        newCache.assign(tri, tri + 3);
+        for (size_t i = 0; i < cache.size(); ++i)
+            if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+                newCache.push_back(cache[i]);
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int *begin = &adjacency[offsets[tri[k]]];
+            unsigned int *end = begin + remaining[tri[k]];
+            std::remove(begin, end, (unsigned int)best); // drop the triangle from the remaining ones
+            --remaining[tri[k]];
+        }
+        for (size_t i = kCacheSize; i < newCache.size(); ++i)
+        {
+            // pushed out of the cache: its triangles lose the cache bonus
+            cachePosition[newCache[i]] = -1;
+            score[newCache[i]] = vertexScore(-1, remaining[newCache[i]]);
+        }
+        if (newCache.size() > (size_t)kCacheSize)
+            newCache.resize(kCacheSize);
+        cache.swap(newCache);
+
+        // rescore the cached vertices and their triangles, and pick the best one among them
+        for (size_t i = 0; i < cache.size(); ++i)
+        {
+            cachePosition[cache[i]] = i;
+            score[cache[i]] = vertexScore(i, remaining[cache[i]]);
+        }
+        best = -1;
+        float bestScore = -1.0f;
+        for (size_t i = 0; i < cache.size(); ++i)
+        {
+            const unsigned int v = cache[i];
+            for (unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; ++a)
+            {
+                const unsigned int t = adjacency[a];
+                const float s = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+                if (s > bestScore)
+                {
+                    bestScore = s;
+                    best = t;
+                }
+            }
+        }
+        // no candidate in the cache: continue with the next triangle not drawn yet
+        if (best < 0)
+        {
+            while (scanCursor < triangleCount && emitted[scanCursor])
+                ++scanCursor;
+            if (scanCursor < triangleCount)
+                best = scanCursor;
+        }
+    }
+
+    // an input order that is already good (e.g., grid rows shorter than the cache) may beat the greedy one
+    for (const size_t cacheSize : kFifoSizes)
+        if (analyzeVertexCache(result, vertexCount, cacheSize).acmr > analyzeVertexCache(indices, vertexCount, cacheSize).acmr)
+            return;
+    indices.swap(result);
+}
+
+std::vector<unsigned int> optimizeVertexFetch(IndexArray &indices, const size_t vertexCount, size_t &newVertexCount)
+{
+    std::vector<unsigned int> remap(vertexCount, ~0u);
+    newVertexCount = 0;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        unsigned int &r = remap[indices[i]];
+        if (r == ~0u)
+            r = newVertexCount++;
+        indices[i] = r;
+    }
+    return remap;
+}
+
+void remapVertexAttribute(FloatArray &attribute, const size_t components, const std::vector<unsigned int> &remap, const size_t newVertexCount)
+{
+    FloatArray result(newVertexCount * components);
+    for (size_t v = 0; v < remap.size(); ++v)
+    {
+        if (remap[v] == ~0u)
+            continue;
+        std::copy(attribute.begin() + v * components, attribute.begin() + (v + 1) * components, result.begin() + remap[v] * components);
+    }
+    attribute.swap(result);
+}
@@ -0,0 +1,30 @@
+#ifndef MESHOPT_H
+#define MESHOPT_H
+
+#include <vector>
+#include <cstddef>
+#include "meshdata.h"
+
+// Index buffer optimizations, run on the CPU-side triangle lists before the upload to the GPU.
+// All of them keep the triangles (and their winding) and only change their order, or the order of the vertices.
+
+// Efficiency of the post-transform vertex cache for an index buffer, with a simulated FIFO cache
+struct VertexCacheStats
+{
+  float acmr; // average cache miss ratio: transformed vertices per triangle (0.5 is optimal on large grids, 3 is worst)
+  float atvr; // average transformed vertex ratio: transformed vertices per used vertex (1 is optimal)
+};
+
+VertexCacheStats analyzeVertexCache(const IndexArray &indices, const size_t vertexCount, const size_t cacheSize = 16);
+
+// Reorders the triangles for the post-transform vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation");
+// keeps the input order if the new one misses more on a FIFO cache of 16 or 32 entries
+void optimizeVertexCache(IndexArray &indices, const size_t vertexCount);
+
+// Renumbers the vertices in the order of their first use by the index buffer so that vertex fetches move
+// forward in memory; unused vertices are dropped. Returns the remap table (old index -> new index, or ~0u)
+// and the new vertex count, to be applied to every attribute with remapVertexAttribute().
+std::vector<unsigned int> optimizeVertexFetch(IndexArray &indices, const size_t vertexCount, size_t &newVertexCount);
+void remapVertexAttribute(FloatArray &attribute, const size_t components, const std::vector<unsigned int> &remap, const size_t newVertexCount);
+
+#endif // MESHOPT_H
@@ -0,0 +1,76 @@
+#include "occlusion.h"
+#include <cmath>
+#include <glm/ext.hpp>
+
+OcclusionCuller::OcclusionCuller(std::shared_ptr<Mesh> proxy) : m_proxy(proxy)
+{
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    for (Frame &frame : m_frames)
+        if (!frame.queries.empty())
+            glDeleteQueries(frame.queries.size(), frame.queries.data());
+}
+
+void OcclusionCuller::beginFrame()
+{
+    m_frame = (m_frame + 1) % kFrameCount;
+    Frame &frame = m_frames[m_frame];
+    if (frame.used > 0)
+    {
+        // results become available in order: the last query tells for all of them
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            m_tested = frame.used;
+            m_skipped = 0;
+            for (size_t i = 0; i < frame.used; ++i)
+            {
+                GLuint anySamples = GL_TRUE;
+                glGetQueryObjectuiv(frame.queries[i], GL_QUERY_RESULT, &anySamples);
+                m_skipped += anySamples == GL_FALSE;
+            }
+        }
+    }
+    frame.used = 0;
+}
+
+void OcclusionCuller::beginDraw(const BoundingSphere &bounds, const glm::vec3 &camera, const float near)
+{
+    // the box corners are sqrt(3) radii away from the center, and the near plane clips what is closer than near
+    if (bounds.radius < 0 || glm::distance(camera, bounds.center) < std::sqrt(3.0f) * bounds.radius + near)
+        return;
+    Frame &frame = m_frames[m_frame];
+    if (frame.used == frame.queries.size())
+    {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    const GLuint query = frame.queries[frame.used++];
+
+    const glm::mat4 model = glm::translate(glm::mat4(1.0f), bounds.center) * glm::scale(glm::mat4(1.0f), glm::vec3(std::sqrt(3.0f) * bounds.radius));
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, query);
+    m_proxy->render(model, kDefaultMaterial);
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+
+    glBeginConditionalRender(query, GL_QUERY_WAIT); // the GPU waits for the query, not the CPU
+    m_conditional = true;
+}
+
+void OcclusionCuller::endDraw()
+{
+    if (m_conditional)
+        glEndConditionalRender();
+    m_conditional = false;
+}
+
+size_t OcclusionCuller::testedCount() const { return m_tested; }
+
+size_t OcclusionCuller::skippedCount() const { return m_skipped; }
@@ -0,0 +1,52 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/gl.h>
+#include "bounds.h"
+#include "mesh.h"
+
+// Hardware occlusion culling: before a body is drawn, a box around its bounds is rasterized against the depth
+// buffer with a GL_ANY_SAMPLES_PASSED query, color and depth writes off, and the body is drawn under
+// glBeginConditionalRender: the GPU drops its draw when no sample of the box passed, with no CPU readback.
+// Only what was drawn before can hide a body, so draw front to back.
+// The query results are only read for the statistics, a few frames later and when available.
+class OcclusionCuller
+{
+public:
+  // proxy: unit cube sphere of resolution 1, whose corners are the corners of a cube of half size 1/sqrt(3)
+  explicit OcclusionCuller(std::shared_ptr<Mesh> proxy);
+  ~OcclusionCuller();
+  OcclusionCuller(const OcclusionCuller &) = delete;
+  OcclusionCuller &operator=(const OcclusionCuller &) = delete;
+
+  // Collects the results of an earlier frame if the GPU has them, and starts using another set of queries
+  void beginFrame();
+  // Tests the world space bounds and makes the next draws conditional on the result, until endDraw().
+  // Nothing is tested when the camera may be inside the box: its faces would not be rasterized.
+  void beginDraw(const BoundingSphere &bounds, const glm::vec3 &camera, const float near);
+  void endDraw();
+
+  size_t testedCount() const;  // bodies tested, in the last frame whose results were read
+  size_t skippedCount() const; // among them, the ones the GPU did not draw
+
+private:
+  static const size_t kFrameCount = 3; // query sets in flight: results are read kFrameCount frames later
+
+  struct Frame
+  {
+    std::vector<GLuint> queries;
+    size_t used = 0;
+  };
+
+  std::shared_ptr<Mesh> m_proxy;
+  Frame m_frames[kFrameCount];
+  size_t m_frame = 0;
+  bool m_conditional = false; // between beginDraw() and endDraw() of a tested body
+  size_t m_tested = 0;
+  size_t m_skipped = 0;
+};
+
+#endif // OCCLUSION_H
@@ -0,0 +1,90 @@
+#include "orbit.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <glm/gtc/constants.hpp>
+#include "glstate.h"
+
+OrbitalBelt::OrbitalBelt(std::shared_ptr<Mesh> mesh, const std::vector<OrbitParams> &orbits)
+    : m_mesh(mesh), m_count(orbits.size())
+{
+    const BoundingSphere &body = m_mesh->boundingSphere();
+    for (const OrbitParams &o : orbits)
+    {
+        const float reach = o.radius + o.scale * (body.radius >= 0 ? glm::length(body.center) + body.radius : 1.0f);
+        m_bounds.radius = std::max(m_bounds.radius, reach);
+    }
+
+    // own VAO: the mesh geometry plus the orbit parameters as per-instance attributes
+    glGenVertexArrays(1, &m_vao);
+    g_glState.bindVertexArray(m_vao);
+    m_mesh->bindVertexAttributes();
+
+    glGenBuffers(1, &m_orbitVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_orbitVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(OrbitParams) * orbits.size(), orbits.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(OrbitParams), (void *)offsetof(OrbitParams, radius)); // radius, phase, orbitSpeed, spinSpeed
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(OrbitParams), (void *)offsetof(OrbitParams, tilt)); // tilt, scale
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
+
+    g_glState.bindVertexArray(0);
+}
+
+OrbitalBelt::~OrbitalBelt()
+{
+    glDeleteBuffers(1, &m_orbitVbo);
+    g_glState.forgetVertexArray(m_vao);
+    glDeleteVertexArrays(1, &m_vao);
+}
+
+void OrbitalBelt::render(const float time, const MaterialHandle material, const GLuint firstPickId) const
+{
+    if (m_count == 0)
+        return;
+    g_orbitalProgram.use();
+    m_mesh->setVertexDecodeUniforms(g_orbitalProgram);
+    g_orbitalProgram.time.set(time); // the only per-frame data of the belt
+    g_orbitalProgram.pickId.set(firstPickId);
+    g_materials.get(material).apply(g_orbitalProgram); // the belt has its own variant, whatever the material says
+
+    g_glState.bindVertexArray(m_vao);
+    m_mesh->drawElements(m_count);
+}
+
+size_t OrbitalBelt::size() const { return m_count; }
+
+const BoundingSphere &OrbitalBelt::boundingSphere() const { return m_bounds; }
+
+glm::vec3 OrbitalBelt::position(const OrbitParams &orbit, const float time)
+{
+    const float orbitAngle = orbit.phase + time * orbit.orbitSpeed;
+    return glm::vec3(orbit.radius * cosf(orbitAngle), 0.0f, -orbit.radius * sinf(orbitAngle)); // rotY(orbitAngle) * (radius, 0, 0)
+}
+
+std::vector<OrbitParams> OrbitalBelt::genAsteroidBelt(const size_t count, const float innerRadius, const float outerRadius,
+                                                      const float minScale, const float maxScale, const unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> radiusDist(innerRadius, outerRadius);
+    std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * glm::pi<float>());
+    std::uniform_real_distribution<float> spinDist(0.5f, 3.0f);
+    std::uniform_real_distribution<float> scaleDist(minScale, maxScale);
+    const float kepler = 0.5f * std::pow(10.0f, 1.5f); // same speed as the earth (0.5 rad/s) at a radius of 10
+
+    std::vector<OrbitParams> orbits(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        OrbitParams &o = orbits[i];
+        o.radius = radiusDist(rng);
+        o.phase = angleDist(rng);
+        o.orbitSpeed = kepler / std::pow(o.radius, 1.5f);
+        o.spinSpeed = spinDist(rng);
+        o.tilt = angleDist(rng);
+        o.scale = scaleDist(rng);
+    }
+    return orbits;
+}
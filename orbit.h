@@ -0,0 +1,55 @@
+#ifndef ORBIT_H
+#define ORBIT_H
+
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include <glad/gl.h>
+#include "mesh.h"
+
+extern SceneProgram g_orbitalProgram; // vertex shader compiled with ORBITAL
+
+// Motion of one body on a circular orbit around the origin, in the XZ plane.
+// Read by the ORBITAL vertex shader which rebuilds the model matrix from the time.
+struct OrbitParams
+{
+  float radius;     // orbit radius
+  float phase;      // orbit angle at time 0, in radians
+  float orbitSpeed; // orbit angular speed, in radians per second
+  float spinSpeed;  // angular speed around the body's own axis, in radians per second
+  float tilt;       // axial tilt, in radians
+  float scale;      // size of the body
+};
+
+// Many bodies sharing a mesh whose motion is evaluated on the GPU: the orbit parameters are
+// uploaded once in a static instance buffer and each frame only costs the time uniform.
+// The instanced path of the scene: its own VAO holds the instance attributes, not the one of the mesh.
+class OrbitalBelt
+{
+public:
+  OrbitalBelt(std::shared_ptr<Mesh> mesh, const std::vector<OrbitParams> &orbits);
+  ~OrbitalBelt();
+  OrbitalBelt(const OrbitalBelt &) = delete;
+  OrbitalBelt &operator=(const OrbitalBelt &) = delete;
+
+  // Body i is written as firstPickId + i to the IdBuffer when drawing into it
+  void render(const float time, const MaterialHandle material, const GLuint firstPickId = 0) const;
+  size_t size() const;
+  // World space sphere holding every body at any time: the orbits are centered on the origin
+  const BoundingSphere &boundingSphere() const;
+
+  // Center of the body at this time, as computed by orbitalModelMatrix() in vertexShader.glsl
+  static glm::vec3 position(const OrbitParams &orbit, const float time);
+  // Random orbits between the two radii, with Kepler-like speeds (slower further away)
+  static std::vector<OrbitParams> genAsteroidBelt(const size_t count, const float innerRadius, const float outerRadius,
+                                                  const float minScale, const float maxScale, const unsigned int seed = 0);
+
+private:
+  std::shared_ptr<Mesh> m_mesh;
+  size_t m_count = 0;
+  BoundingSphere m_bounds;
+  GLuint m_vao = 0;
+  GLuint m_orbitVbo = 0;
+};
+
+#endif // ORBIT_H
@@ -0,0 +1,145 @@
+#include "picking.h"
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+// Refitting keeps the tree valid but its boxes grow as neighbouring rocks part on their orbits: past this much
+// orbit time since the build, the tree is rebuilt instead (the inner rocks turn by about 2 radians per second)
+const float kRebuildInterval = 1.0f;
+} // namespace
+
+BodyPicker::BodyPicker(const size_t bodyCount, const std::vector<OrbitParams> &rocks, const float rockRadius)
+    : m_bodies(bodyCount), m_rocks(rocks), m_rockRadius(rockRadius)
+{
+}
+
+void BodyPicker::setBody(const size_t body, const BoundingSphere &bounds)
+{
+    m_bodies[body] = bounds;
+}
+
+void BodyPicker::moveRocks(const float time)
+{
+    const size_t bodyCount = m_bodies.size();
+    if (!m_built || std::fabs(time - m_buildTime) > kRebuildInterval)
+    {
+        std::vector<BoundingSphere> spheres(m_bodies);
+        spheres.resize(bodyCount + m_rocks.size());
+        for (size_t i = 0; i < m_rocks.size(); ++i)
+        {
+            spheres[bodyCount + i].center = OrbitalBelt::position(m_rocks[i], time);
+            spheres[bodyCount + i].radius = m_rocks[i].scale * m_rockRadius;
+        }
+        m_bvh.build(spheres);
+        m_buildTime = time;
+        m_built = true;
+        return;
+    }
+    for (size_t i = 0; i < bodyCount; ++i)
+        m_bvh.update(i, m_bodies[i]);
+    BoundingSphere sphere;
+    for (size_t i = 0; i < m_rocks.size(); ++i)
+    {
+        sphere.center = OrbitalBelt::position(m_rocks[i], time);
+        sphere.radius = m_rocks[i].scale * m_rockRadius;
+        m_bvh.update(bodyCount + i, sphere);
+    }
+    m_bvh.refit();
+}
+
+int BodyPicker::pick(const float time, const glm::vec3 &origin, const glm::vec3 &direction, float &t)
+{
+    moveRocks(time);
+    return m_bvh.raycast(origin, direction, t);
+}
+
+size_t BodyPicker::bodyCount() const { return m_bodies.size(); }
+
+IdBuffer::~IdBuffer()
+{
+    if (m_fence)
+        glDeleteSync(m_fence);
+    glDeleteBuffers(1, &m_pbo);
+    glDeleteRenderbuffers(1, &m_idRenderbuffer);
+    glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+    glDeleteFramebuffers(1, &m_fbo);
+}
+
+void IdBuffer::resize(const int width, const int height)
+{
+    if (m_fbo == 0)
+    {
+        glGenFramebuffers(1, &m_fbo);
+        glGenRenderbuffers(1, &m_idRenderbuffer);
+        glGenRenderbuffers(1, &m_depthRenderbuffer);
+        glGenBuffers(1, &m_pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_READ);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, m_idRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_idRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+    // fragment output 0 (the color) goes nowhere, output 1 (the pick id) to the id buffer
+    const GLenum drawBuffers[2] = {GL_NONE, GL_COLOR_ATTACHMENT0};
+    glDrawBuffers(2, drawBuffers);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "ERROR: incomplete picking framebuffer" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    m_width = width;
+    m_height = height;
+}
+
+void IdBuffer::begin(const int width, const int height, const int x, const int y)
+{
+    if (width != m_width || height != m_height)
+        resize(width, height);
+    m_x = glm::clamp(x, 0, width - 1);
+    m_y = glm::clamp(y, 0, height - 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(m_x, m_y, 1, 1);
+    const GLuint noId = 0;
+    const GLfloat farDepth = 1.0f;
+    glClearBufferuiv(GL_COLOR, 1, &noId); // draw buffer 1 is the id attachment
+    glClearBufferfv(GL_DEPTH, 0, &farDepth);
+}
+
+void IdBuffer::end()
+{
+    glDisable(GL_SCISSOR_TEST);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+    glReadPixels(m_x, m_y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr); // into the buffer: returns at once
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (m_fence)
+        glDeleteSync(m_fence);
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool IdBuffer::poll(GLuint &id)
+{
+    if (!m_fence)
+        return false;
+    const GLenum status = glClientWaitSync(m_fence, 0, 0); // zero timeout: only asks
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+    glDeleteSync(m_fence);
+    m_fence = nullptr;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo);
+    const GLuint *pixel = (const GLuint *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT);
+    id = pixel ? *pixel : 0;
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+bool IdBuffer::pending() const { return m_fence != nullptr; }
@@ -0,0 +1,73 @@
+#ifndef PICKING_H
+#define PICKING_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/gl.h>
+#include "bounds.h"
+#include "bvh.h"
+#include "orbit.h"
+
+// Body under a ray among a few bodies placed by the caller and the rocks of an asteroid belt, found with
+// analytic ray-sphere tests through a Bvh. The rocks are only moved to the picking time when a pick is made:
+// their boxes are refitted, and the tree is rebuilt once they have drifted too far along their orbits.
+class BodyPicker
+{
+public:
+  // bodyCount bodies placed with setBody(), then the rocks; rockRadius: radius of the rock mesh for a scale of 1
+  BodyPicker(const size_t bodyCount, const std::vector<OrbitParams> &rocks, const float rockRadius);
+
+  // World space bounds of body i < bodyCount, used from the next pick on
+  void setBody(const size_t body, const BoundingSphere &bounds);
+  // Index of the closest body hit at this time (bodyCount + i for rock i) and its distance t, -1 if none
+  int pick(const float time, const glm::vec3 &origin, const glm::vec3 &direction, float &t);
+
+  size_t bodyCount() const;
+
+private:
+  void moveRocks(const float time);
+
+  std::vector<BoundingSphere> m_bodies; // placed by setBody()
+  std::vector<OrbitParams> m_rocks;
+  float m_rockRadius;
+  Bvh m_bvh;
+  float m_buildTime = 0.0f; // time of the rock positions the tree was built for
+  bool m_built = false;
+};
+
+// Offscreen target holding, per pixel, the pick id of the closest surface (0 for none), written by the second
+// output of the fragment shader. Only the picked pixel is drawn (scissor), and it is read back asynchronously:
+// copied into a pixel buffer object, then mapped once a fence tells that the copy is done, so that picking
+// never waits for the GPU.
+class IdBuffer
+{
+public:
+  IdBuffer() = default;
+  ~IdBuffer();
+  IdBuffer(const IdBuffer &) = delete;
+  IdBuffer &operator=(const IdBuffer &) = delete;
+
+  // Draws into the buffer, sized as the framebuffer, at pixel (x, y) only (origin at the bottom left).
+  // Then draw the scene with pick ids and call end().
+  void begin(const int width, const int height, const int x, const int y);
+  // Starts the copy of the pixel and goes back to the default framebuffer
+  void end();
+  // True once the copy of the last end() has completed, with the id of the pixel; never blocks
+  bool poll(GLuint &id);
+  bool pending() const; // a copy has been started and not polled yet
+
+private:
+  void resize(const int width, const int height);
+
+  GLuint m_fbo = 0;
+  GLuint m_idRenderbuffer = 0;
+  GLuint m_depthRenderbuffer = 0;
+  GLuint m_pbo = 0;
+  GLsync m_fence = nullptr;
+  int m_width = 0;
+  int m_height = 0;
+  int m_x = 0;
+  int m_y = 0;
+};
+
+#endif // PICKING_H
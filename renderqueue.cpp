@@ -0,0 +1,128 @@
+#include "renderqueue.h"
+#include <algorithm>
+#include <cstring>
+#include "occlusion.h"
+
+namespace
+{
+// Key fields (see RenderQueue): ids wider than their field wrap, which only mixes their groups
+const int kPassShift = 62;
+const int kStateBits = 30; // program (6), material (10), mesh (14)
+const uint64_t kDepthMask = 0xFFFFFFFFull;
+
+// Positive floats are ordered as their bit patterns
+uint64_t depthBits(const float depth)
+{
+    const float positive = std::max(depth, 0.0f);
+    uint32_t bits;
+    std::memcpy(&bits, &positive, sizeof(bits));
+    return bits;
+}
+} // namespace
+
+void RenderQueue::setSortMode(const SortMode mode) { m_mode = mode; }
+
+void RenderQueue::begin(const Camera &camera)
+{
+    m_camera = camera.getPosition();
+    m_near = camera.getNear();
+    m_items.clear();
+    m_packets.clear();
+}
+
+uint32_t RenderQueue::meshId(const Mesh *mesh)
+{
+    const std::unordered_map<const Mesh *, uint32_t>::const_iterator it = m_meshIds.find(mesh);
+    if (it != m_meshIds.end())
+        return it->second;
+    const uint32_t id = m_meshIds.size();
+    m_meshIds[mesh] = id;
+    return id;
+}
+
+void RenderQueue::submit(const DrawItem &item, const RenderPass pass)
+{
+    // materials sharing a texture are not grouped, but a scene has few materials per texture
+    const uint64_t program = item.mesh->program(g_materials.get(item.material)).id() & 0x3F;
+    const uint64_t material = item.material & 0x3FF;
+    const uint64_t mesh = meshId(item.mesh) & 0x3FFF;
+    const uint64_t state = program << 24 | material << 14 | mesh;
+    const glm::vec3 center = item.bounds.radius >= 0 ? item.bounds.center : glm::vec3(item.model[3]);
+    const uint64_t depth = depthBits(glm::distance(m_camera, center));
+
+    uint64_t key = (uint64_t)pass << kPassShift;
+    if (pass == RenderPass::Transparent)
+        key |= (~depth & kDepthMask) << kStateBits | state; // back to front
+    else if (m_mode == SortMode::FrontToBack)
+        key |= depth << kStateBits | state;
+    else
+        key |= state << 32 | depth;
+
+    Packet packet;
+    packet.key = key;
+    packet.item = m_items.size();
+    m_packets.push_back(packet);
+    m_items.push_back(item);
+}
+
+size_t RenderQueue::stateChanges() const
+{
+    size_t changes = 0;
+    for (size_t i = 1; i < m_packets.size(); ++i)
+    {
+        const DrawItem &previous = m_items[m_packets[i - 1].item], &current = m_items[m_packets[i].item];
+        const Material &previousMaterial = g_materials.get(previous.material), &currentMaterial = g_materials.get(current.material);
+        changes += &previous.mesh->program(previousMaterial) != &current.mesh->program(currentMaterial);
+        changes += previousMaterial.albedoTexture != currentMaterial.albedoTexture;
+        changes += previous.mesh != current.mesh; // vertex array
+    }
+    return changes;
+}
+
+void RenderQueue::radixSort()
+{
+    // one histogram per byte, all in a single pass
+    size_t counts[8][256] = {};
+    for (const Packet &packet : m_packets)
+        for (int byte = 0; byte < 8; ++byte)
+            ++counts[byte][(packet.key >> (8 * byte)) & 0xFF];
+
+    m_scratch.resize(m_packets.size());
+    for (int byte = 0; byte < 8; ++byte)
+    {
+        size_t *count = counts[byte];
+        if (count[(m_packets[0].key >> (8 * byte)) & 0xFF] == m_packets.size())
+            continue; // every key has this byte: nothing to reorder
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; ++digit)
+        {
+            const size_t n = count[digit];
+            count[digit] = offset;
+            offset += n;
+        }
+        for (const Packet &packet : m_packets)
+            m_scratch[count[(packet.key >> (8 * byte)) & 0xFF]++] = packet; // stable
+        m_packets.swap(m_scratch);
+    }
+}
+
+void RenderQueue::execute(OcclusionCuller *occlusion)
+{
+    m_stats.draws = m_packets.size();
+    m_stats.submittedChanges = stateChanges();
+    if (!m_packets.empty())
+        radixSort();
+    m_stats.sortedChanges = stateChanges();
+
+    for (const Packet &packet : m_packets)
+    {
+        const DrawItem &item = m_items[packet.item];
+        if (occlusion)
+            occlusion->beginDraw(item.bounds, m_camera, m_near);
+        item.mesh->render(item.model, item.material, item.pickId);
+        if (occlusion)
+            occlusion->endDraw();
+    }
+}
+
+const RenderQueueStats &RenderQueue::stats() const { return m_stats; }
@@ -0,0 +1,85 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/gl.h>
+#include "bounds.h"
+#include "mesh.h"
+#include "camera.h"
+
+class OcclusionCuller;
+
+// Passes, the most significant bits of the keys: all opaque draws come before the transparent ones
+enum class RenderPass
+{
+  Opaque = 0,
+  Transparent = 1
+};
+
+// Order of the opaque draws. The transparent ones are always drawn back to front.
+enum class SortMode
+{
+  State,      // by program, material, mesh, then depth: fewest state changes
+  FrontToBack // by depth first, for early depth rejection and occlusion culling
+};
+
+// What Mesh::render() is called with for one draw
+struct DrawItem
+{
+  Mesh *mesh;
+  glm::mat4 model;
+  MaterialHandle material;
+  GLuint pickId;
+  BoundingSphere bounds; // world space, for the occlusion test; empty for none
+};
+
+// Program, texture and mesh changes between consecutive draws of a frame
+struct RenderQueueStats
+{
+  size_t draws = 0;
+  size_t submittedChanges = 0; // in the order of submission
+  size_t sortedChanges = 0;    // in the order of execution
+};
+
+// Draws submitted in any order, then sorted and executed by 64-bit keys. The key packs, from the most significant
+// bits: pass (2), then program (6), material (10), mesh (14) and depth (32, float bits) in the State mode, or the depth
+// first in the FrontToBack mode and for the transparent pass (with its bits inverted: back to front).
+// Keys are sorted with an LSD radix sort that skips the bytes every key shares.
+class RenderQueue
+{
+public:
+  void setSortMode(const SortMode mode);
+  // Starts a frame seen from this camera
+  void begin(const Camera &camera);
+  void submit(const DrawItem &item, const RenderPass pass = RenderPass::Opaque);
+  // Sorts the draws and executes them in order; tests each one with occlusion if not null
+  void execute(OcclusionCuller *occlusion = nullptr);
+
+  const RenderQueueStats &stats() const; // of the last execute()
+
+private:
+  // Draw packet: the key and where the item is
+  struct Packet
+  {
+    uint64_t key;
+    uint32_t item;
+  };
+
+  uint32_t meshId(const Mesh *mesh);
+  size_t stateChanges() const; // between consecutive packets, in their current order
+  void radixSort();
+
+  SortMode m_mode = SortMode::State;
+  glm::vec3 m_camera = glm::vec3(0.0f);
+  float m_near = 0.0f;
+  std::vector<DrawItem> m_items;
+  std::vector<Packet> m_packets;
+  std::vector<Packet> m_scratch;                   // radix sort buffer
+  std::unordered_map<const Mesh *, uint32_t> m_meshIds; // small ids for the keys, kept across frames
+  RenderQueueStats m_stats;
+};
+
+#endif // RENDERQUEUE_H
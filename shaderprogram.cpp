@@ -0,0 +1,228 @@
+#include "shaderprogram.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <glm/gtc/type_ptr.hpp>
+#include "glstate.h"
+
+template <> void Uniform<float>::set(const float &value) const { glUniform1f(m_location, value); }
+template <> void Uniform<int>::set(const int &value) const { glUniform1i(m_location, value); }
+template <> void Uniform<GLuint>::set(const GLuint &value) const { glUniform1ui(m_location, value); }
+template <> void Uniform<glm::vec2>::set(const glm::vec2 &value) const { glUniform2fv(m_location, 1, glm::value_ptr(value)); }
+template <> void Uniform<glm::vec3>::set(const glm::vec3 &value) const { glUniform3fv(m_location, 1, glm::value_ptr(value)); }
+template <> void Uniform<glm::vec4>::set(const glm::vec4 &value) const { glUniform4fv(m_location, 1, glm::value_ptr(value)); }
+template <> void Uniform<glm::mat3>::set(const glm::mat3 &value) const { glUniformMatrix3fv(m_location, 1, GL_FALSE, glm::value_ptr(value)); }
+template <> void Uniform<glm::mat4>::set(const glm::mat4 &value) const { glUniformMatrix4fv(m_location, 1, GL_FALSE, glm::value_ptr(value)); }
+
+namespace
+{
+// Samplers are set as an int, the texture unit
+bool isSampler(const GLenum type)
+{
+    switch (type)
+    {
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_1D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_BUFFER:
+    case GL_INT_SAMPLER_2D:
+    case GL_INT_SAMPLER_2D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Reads the active uniforms or attributes (what: GL_ACTIVE_UNIFORMS or GL_ACTIVE_ATTRIBUTES)
+template <typename Variable, typename GetActive, typename GetLocation>
+void readActive(const GLuint program, const GLenum what, const GLenum maxLength, GetActive getActive, GetLocation getLocation,
+                std::map<std::string, Variable> &variables)
+{
+    GLint count = 0, length = 0;
+    glGetProgramiv(program, what, &count);
+    glGetProgramiv(program, maxLength, &length);
+    std::vector<GLchar> name(std::max(length, 1));
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLint size = 0;
+        Variable variable;
+        getActive(program, i, (GLsizei)name.size(), nullptr, &size, &variable.type, name.data());
+        std::string key(name.data());
+        if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0)
+            key.resize(key.size() - 3); // arrays are listed by their first element
+        variable.location = getLocation(program, name.data());
+        if (variable.location >= 0) // uniform block members have none
+            variables[key] = variable;
+    }
+}
+} // namespace
+
+ShaderProgram::~ShaderProgram()
+{
+    if (m_id != 0)
+    {
+        g_glState.forgetProgram(m_id);
+        glDeleteProgram(m_id);
+    }
+}
+
+void ShaderProgram::reset(const GLuint program)
+{
+    if (m_id != 0)
+    {
+        g_glState.forgetProgram(m_id);
+        glDeleteProgram(m_id);
+    }
+    m_id = program;
+    m_uniforms.clear();
+    m_attributes.clear();
+    if (m_id == 0)
+        return;
+
+    GLint success = GL_FALSE;
+    glGetProgramiv(m_id, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        GLchar infoLog[512];
+        glGetProgramInfoLog(m_id, 512, NULL, infoLog);
+        std::cout << "ERROR in linking the program\n\t" << infoLog << std::endl;
+        return;
+    }
+    readActive(m_id, GL_ACTIVE_UNIFORMS, GL_ACTIVE_UNIFORM_MAX_LENGTH, glGetActiveUniform, glGetUniformLocation, m_uniforms);
+    readActive(m_id, GL_ACTIVE_ATTRIBUTES, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, glGetActiveAttrib, glGetAttribLocation, m_attributes);
+}
+
+void ShaderProgram::use() const { g_glState.useProgram(m_id); }
+
+GLuint ShaderProgram::id() const { return m_id; }
+
+GLint ShaderProgram::resolve(const std::string &name, const GLenum type)
+{
+    const std::map<std::string, Variable>::iterator it = m_uniforms.find(name);
+    if (it == m_uniforms.end())
+        return -1;
+    Variable &variable = it->second;
+    variable.resolved = true;
+    const bool matches = variable.type == type || (type == GL_INT && (variable.type == GL_BOOL || isSampler(variable.type)));
+    if (!matches)
+        std::cout << "ERROR: uniform " << name << " has the GLSL type 0x" << std::hex << variable.type
+                  << " but is set as 0x" << type << std::dec << std::endl;
+    return variable.location;
+}
+
+GLint ShaderProgram::attributeLocation(const std::string &name) const
+{
+    const std::map<std::string, Variable>::const_iterator it = m_attributes.find(name);
+    return it != m_attributes.end() ? it->second.location : -1;
+}
+
+GLint ShaderProgram::bindUniformBlock(const std::string &name, const GLuint binding) const
+{
+    const GLuint index = glGetUniformBlockIndex(m_id, name.c_str());
+    if (index == GL_INVALID_INDEX)
+        return 0;
+    glUniformBlockBinding(m_id, index, binding);
+    GLint size = 0;
+    glGetActiveUniformBlockiv(m_id, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    return size;
+}
+
+GLint ShaderProgram::uniformOffset(const std::string &name) const
+{
+    const GLchar *names[1] = {name.c_str()};
+    GLuint index = GL_INVALID_INDEX;
+    glGetUniformIndices(m_id, 1, names, &index);
+    if (index == GL_INVALID_INDEX)
+        return -1;
+    GLint offset = -1;
+    glGetActiveUniformsiv(m_id, 1, &index, GL_UNIFORM_OFFSET, &offset);
+    return offset;
+}
+
+void ShaderProgram::reportUnresolved(const std::string &programName) const
+{
+    for (const std::pair<const std::string, Variable> &uniform : m_uniforms)
+        if (!uniform.second.resolved)
+            std::cout << "WARNING: uniform " << uniform.first << " of the " << programName << " program is never set" << std::endl;
+}
+
+void SceneProgram::reset(const GLuint program)
+{
+    ShaderProgram::reset(program);
+    if (id() == 0)
+        return;
+    modelMat = uniform<glm::mat4>("modelMat");
+    lColor = uniform<glm::vec3>("lColor");
+    emission = uniform<glm::vec3>("emission");
+    pickId = uniform<GLuint>("pickId");
+    albedoTex = uniform<int>("material.albedoTex");
+    albedoLayer = uniform<float>("albedoLayer");
+    posOffset = uniform<glm::vec3>("posOffset");
+    posScale = uniform<glm::vec3>("posScale");
+    octScale = uniform<float>("octScale");
+    uvOffset = uniform<glm::vec2>("uvOffset");
+    uvScale = uniform<glm::vec2>("uvScale");
+    sphereResolution = uniform<int>("sphereResolution");
+    time = uniform<float>("time");
+    morphRange = uniform<glm::vec2>("morphRange");
+    gridSize = uniform<float>("gridSize");
+    heightScale = uniform<float>("heightScale");
+    cameraLocal = uniform<glm::vec3>("cameraLocal");
+    heightMap = uniform<int>("heightMap");
+
+    // the attribute locations the VAOs of Mesh, OrbitalBelt and PlanetTerrain are set up with
+    static const std::pair<const char *, GLint> kAttributes[] = {
+        {"vPosition", 0}, {"vNormal", 1}, {"vTexCoord", 2}, {"vGrid", 0}, {"iModelMat", 3},
+        {"iLColor", 7}, {"iEmission", 8}, {"iAlbedoLayer", 9}, {"iOrbit", 3}, {"iBody", 4},
+        {"iPatch", 3}, {"iFace", 4}};
+    for (const std::pair<const char *, GLint> &attribute : kAttributes)
+    {
+        const GLint location = attributeLocation(attribute.first);
+        if (location >= 0 && location != attribute.second)
+            std::cout << "ERROR: attribute " << attribute.first << " is at location " << location
+                      << " in GLSL, the vertex arrays use " << attribute.second << std::endl;
+    }
+
+    // the block must have the layout of the C++ struct that fills it
+    const GLint size = bindUniformBlock("FrameData", kFrameDataBinding);
+    static const std::pair<const char *, GLint> kMembers[] = {
+        {"viewMat", offsetof(FrameData, viewMat)}, {"projMat", offsetof(FrameData, projMat)},
+        {"camPos", offsetof(FrameData, camPos)}, {"lightPos", offsetof(FrameData, lightPos)}};
+    if (size != 0 && size != (GLint)sizeof(FrameData))
+        std::cout << "ERROR: the FrameData block has " << size << " bytes in GLSL, " << sizeof(FrameData) << " in C++" << std::endl;
+    for (const std::pair<const char *, GLint> &member : kMembers)
+    {
+        const GLint offset = uniformOffset(member.first);
+        if (offset >= 0 && offset != member.second)
+            std::cout << "ERROR: FrameData::" << member.first << " is at offset " << offset << " in GLSL, "
+                      << member.second << " in C++" << std::endl;
+    }
+}
+
+UniformBuffer::UniformBuffer(const GLuint binding, const GLsizeiptr size) : m_size(size)
+{
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, m_size, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_buffer);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void UniformBuffer::update(const void *data)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, m_size, data, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
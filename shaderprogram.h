@@ -0,0 +1,160 @@
+#ifndef SHADERPROGRAM_H
+#define SHADERPROGRAM_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <glm/glm.hpp>
+#include <glad/gl.h>
+
+// Location of a uniform resolved once by ShaderProgram::uniform(), set with the glUniform call of its type.
+// A uniform the program does not use has location -1: setting it does nothing, as with glUniform.
+template <typename T>
+class Uniform
+{
+public:
+  Uniform() = default;
+  explicit Uniform(const GLint location) : m_location(location) {}
+
+  // On the program in use
+  void set(const T &value) const;
+  bool isActive() const { return m_location >= 0; }
+  GLint location() const { return m_location; }
+
+private:
+  GLint m_location = -1;
+};
+
+template <> void Uniform<float>::set(const float &value) const;
+template <> void Uniform<int>::set(const int &value) const; // also samplers, as a texture unit
+template <> void Uniform<GLuint>::set(const GLuint &value) const;
+template <> void Uniform<glm::vec2>::set(const glm::vec2 &value) const;
+template <> void Uniform<glm::vec3>::set(const glm::vec3 &value) const;
+template <> void Uniform<glm::vec4>::set(const glm::vec4 &value) const;
+template <> void Uniform<glm::mat3>::set(const glm::mat3 &value) const;
+template <> void Uniform<glm::mat4>::set(const glm::mat4 &value) const;
+
+// Linked GPU program with the table of its active uniforms and attributes, read once after linking, so that
+// uniforms are looked up by name only when their handles are made, and their GLSL types checked against C++.
+class ShaderProgram
+{
+public:
+  ShaderProgram() = default;
+  ~ShaderProgram();
+  ShaderProgram(const ShaderProgram &) = delete;
+  ShaderProgram &operator=(const ShaderProgram &) = delete;
+
+  // Takes ownership of a program on which glLinkProgram was called (0 to only release the current one),
+  // reports link errors and reads the active uniforms and attributes
+  void reset(const GLuint program = 0);
+  void use() const;
+  GLuint id() const;
+
+  // Handle of an active uniform, inactive if the program does not use it; reports a type mismatch with T
+  template <typename T>
+  Uniform<T> uniform(const std::string &name);
+  // -1 if the attribute is not active
+  GLint attributeLocation(const std::string &name) const;
+  // Attaches a uniform block to a binding point (GLSL 3.30 has no layout(binding)); data size of the block,
+  // 0 if it is not active
+  GLint bindUniformBlock(const std::string &name, const GLuint binding) const;
+  // Offset of a uniform block member in the block, -1 if it is not active
+  GLint uniformOffset(const std::string &name) const;
+  // Reports the active uniforms no handle was made for: set by nobody on the C++ side
+  void reportUnresolved(const std::string &programName) const;
+
+private:
+  struct Variable
+  {
+    GLint location;
+    GLenum type;         // e.g., GL_FLOAT_VEC3
+    bool resolved = false; // a handle was made for it
+  };
+
+  GLint resolve(const std::string &name, const GLenum type);
+
+  GLuint m_id = 0;
+  std::map<std::string, Variable> m_uniforms; // outside uniform blocks only
+  std::map<std::string, Variable> m_attributes;
+};
+
+// GLSL type of the uniforms set from a T
+template <typename T> GLenum uniformType();
+template <> inline GLenum uniformType<float>() { return GL_FLOAT; }
+template <> inline GLenum uniformType<int>() { return GL_INT; }
+template <> inline GLenum uniformType<GLuint>() { return GL_UNSIGNED_INT; }
+template <> inline GLenum uniformType<glm::vec2>() { return GL_FLOAT_VEC2; }
+template <> inline GLenum uniformType<glm::vec3>() { return GL_FLOAT_VEC3; }
+template <> inline GLenum uniformType<glm::vec4>() { return GL_FLOAT_VEC4; }
+template <> inline GLenum uniformType<glm::mat3>() { return GL_FLOAT_MAT3; }
+template <> inline GLenum uniformType<glm::mat4>() { return GL_FLOAT_MAT4; }
+
+template <typename T>
+Uniform<T> ShaderProgram::uniform(const std::string &name)
+{
+  return Uniform<T>(resolve(name, uniformType<T>()));
+}
+
+// Camera and light of a frame: the std140 layout of the FrameData block of vertexShader.glsl and fragmentShader.glsl
+struct FrameData
+{
+  glm::mat4 viewMat;
+  glm::mat4 projMat;
+  glm::vec3 camPos;
+  float pad0; // a vec3 takes 16 bytes in std140
+  glm::vec3 lightPos;
+  float pad1;
+};
+
+// Binding point of the FrameData block, the same in every program
+const GLuint kFrameDataBinding = 0;
+
+// Storage of a uniform block, bound to a binding point shared by the programs that declare the block
+class UniformBuffer
+{
+public:
+  UniformBuffer(const GLuint binding, const GLsizeiptr size);
+  ~UniformBuffer();
+  UniformBuffer(const UniformBuffer &) = delete;
+  UniformBuffer &operator=(const UniformBuffer &) = delete;
+
+  // Replaces the whole content; orphans the previous one, which draws still in flight may read
+  void update(const void *data);
+  template <typename T>
+  void update(const T &data) { update(static_cast<const void *>(&data)); }
+
+private:
+  GLuint m_buffer = 0;
+  GLsizeiptr m_size;
+};
+
+// One variant of vertexShader.glsl and fragmentShader.glsl, with the handles of every uniform they declare outside
+// the FrameData block (those the variant does not use stay inactive)
+class SceneProgram : public ShaderProgram
+{
+public:
+  // Takes ownership of the program, resolves the handles and binds FrameData to kFrameDataBinding
+  void reset(const GLuint program = 0);
+
+  // per draw (the camera and light are in FrameData)
+  Uniform<glm::mat4> modelMat;
+  Uniform<glm::vec3> lColor, emission;
+  Uniform<GLuint> pickId;
+  Uniform<int> albedoTex; // material.albedoTex
+  Uniform<float> albedoLayer; // per draw, INSTANCED has it per instance
+  // vertex decoding (see Mesh::setVertexDecodeUniforms)
+  Uniform<glm::vec3> posOffset, posScale;
+  Uniform<float> octScale;
+  Uniform<glm::vec2> uvOffset, uvScale;
+  // PROCEDURAL_SPHERE
+  Uniform<int> sphereResolution;
+  // ORBITAL
+  Uniform<float> time;
+  // TERRAIN (the patches are per-instance attributes)
+  Uniform<glm::vec2> morphRange;
+  Uniform<float> gridSize, heightScale;
+  Uniform<glm::vec3> cameraLocal;
+  Uniform<int> heightMap;
+};
+
+#endif // SHADERPROGRAM_H
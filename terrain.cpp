@@ -0,0 +1,306 @@
+#include "terrain.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <cstddef>
+#include <glm/gtc/constants.hpp>
+#include "mesh.h"
+#include "glstate.h"
+#include "camera.h"
+
+namespace
+{
+// each face: its normal n and two axes (u, v) with cross(u, v) = n, as in Mesh::genCubeSphere and kFaceBasis
+// in vertexShader.glsl
+const glm::vec3 kFaces[6][3] = {
+    {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+    {{0, 1, 0}, {0, 0, 1}, {1, 0, 0}}, {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+    {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}}, {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}}};
+
+// Fraction of the morph range (end of the parent range) where the vertices start sliding onto the parent grid
+const float kMorphStart = 0.75f;
+
+// Factor applied to the pixel error of a frame while its selection exceeds the patch budget, and the most times
+const float kErrorStep = 1.25f;
+const int kMaxErrorSteps = 32;
+
+// Point of the unit sphere for face coordinates f in [-1, 1]^2: spherified cube, same as spherify() in vertexShader.glsl
+glm::vec3 spherify(const int face, const glm::vec2 &f)
+{
+    const glm::vec3 p = kFaces[face][0] + f.x * kFaces[face][1] + f.y * kFaces[face][2];
+    const glm::vec3 p2 = p * p;
+    return glm::normalize(glm::vec3(
+        p.x * sqrtf(1 - p2.y / 2 - p2.z / 2 + p2.y * p2.z / 3),
+        p.y * sqrtf(1 - p2.z / 2 - p2.x / 2 + p2.z * p2.x / 3),
+        p.z * sqrtf(1 - p2.x / 2 - p2.y / 2 + p2.x * p2.y / 3)));
+}
+
+float latticeValue(const int x, const int y, const int z, const unsigned int seed)
+{
+    uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u ^ seed * 2654435761u;
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return (h & 0xFFFFFF) / float(0xFFFFFF);
+}
+
+// Trilinear value noise in [0, 1]
+float valueNoise(const glm::vec3 &p, const unsigned int seed)
+{
+    const glm::vec3 cell = glm::floor(p);
+    const glm::vec3 t = p - cell;
+    const glm::vec3 w = t * t * (3.0f - 2.0f * t);
+    const int x = (int)cell.x, y = (int)cell.y, z = (int)cell.z;
+    float c[2][2];
+    for (int j = 0; j < 2; ++j)
+        for (int k = 0; k < 2; ++k)
+            c[j][k] = glm::mix(latticeValue(x, y + j, z + k, seed), latticeValue(x + 1, y + j, z + k, seed), w.x);
+    return glm::mix(glm::mix(c[0][0], c[1][0], w.y), glm::mix(c[0][1], c[1][1], w.y), w.z);
+}
+
+// Fractal sum of octaves, sampled in 3D so that the map has no seam nor pole artifacts
+float fbm(const glm::vec3 &p, const unsigned int seed)
+{
+    float sum = 0.0f, amplitude = 0.5f, frequency = 2.0f;
+    for (int octave = 0; octave < 6; ++octave)
+    {
+        sum += amplitude * valueNoise(p * frequency, seed + octave);
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+    return sum;
+}
+} // namespace
+
+PlanetTerrain::PlanetTerrain(const size_t gridSize, const size_t maxDepth, const float heightScale,
+                             const float pixelError, const size_t patchBudget, const size_t heightmapWidth,
+                             const unsigned int seed)
+    : m_gridSize(gridSize), m_maxDepth(maxDepth), m_heightScale(heightScale), m_pixelError(pixelError),
+      m_patchBudget(std::max<size_t>(patchBudget, 6)), m_heightmapWidth(heightmapWidth)
+{
+    // equirectangular map with the texture coordinates of Mesh::genSphere: s along the longitude, t from the north pole
+    const size_t width = m_heightmapWidth, height = m_heightmapWidth / 2;
+    m_heightmap.resize(width * height);
+    float lo = 1.0f, hi = 0.0f;
+    for (size_t j = 0; j < height; ++j)
+    {
+        const float stackAngle = glm::half_pi<float>() - glm::pi<float>() * (j + 0.5f) / height;
+        for (size_t i = 0; i < width; ++i)
+        {
+            const float sectorAngle = glm::two_pi<float>() * (i + 0.5f) / width;
+            const glm::vec3 d(cosf(stackAngle) * cosf(sectorAngle), cosf(stackAngle) * sinf(sectorAngle), sinf(stackAngle));
+            const float h = fbm(d, seed);
+            m_heightmap[j * width + i] = h;
+            lo = std::min(lo, h);
+            hi = std::max(hi, h);
+        }
+    }
+    for (float &h : m_heightmap)
+        h = (h - lo) / std::max(hi - lo, 1e-6f);
+}
+
+PlanetTerrain::~PlanetTerrain()
+{
+    if (m_vao == 0)
+        return;
+    g_glState.forgetTexture(m_heightTexture);
+    glDeleteTextures(1, &m_heightTexture);
+    glDeleteBuffers(1, &m_instanceVbo);
+    glDeleteBuffers(1, &m_gridIbo);
+    glDeleteBuffers(1, &m_gridVbo);
+    g_glState.forgetVertexArray(m_vao);
+    glDeleteVertexArrays(1, &m_vao);
+}
+
+void PlanetTerrain::init()
+{
+    // the grid shared by every patch: integer vertex coordinates, placed on the sphere by the vertex shader
+    const size_t n = m_gridSize;
+    std::vector<glm::vec2> grid;
+    grid.reserve((n + 1) * (n + 1));
+    for (size_t j = 0; j <= n; ++j)
+        for (size_t i = 0; i <= n; ++i)
+            grid.push_back(glm::vec2(i, j));
+    std::vector<GLushort> indices;
+    indices.reserve(6 * n * n);
+    for (size_t j = 0; j < n; ++j)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            const GLushort k00 = j * (n + 1) + i, k10 = k00 + 1, k01 = k00 + (n + 1), k11 = k01 + 1;
+            const GLushort quad[6] = {k00, k10, k11, k00, k11, k01};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    m_gridIndexCount = indices.size();
+
+    glGenVertexArrays(1, &m_vao);
+    g_glState.bindVertexArray(m_vao);
+    glGenBuffers(1, &m_gridVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_gridVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * grid.size(), grid.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), 0);
+    glEnableVertexAttribArray(0);
+    glGenBuffers(1, &m_gridIbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_gridIbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * indices.size(), indices.data(), GL_STATIC_DRAW);
+    // the patches, one instance each, filled by render()
+    glGenBuffers(1, &m_instanceVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(PatchInstance), (void *)offsetof(PatchInstance, patch));
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(PatchInstance), (void *)offsetof(PatchInstance, face));
+    glEnableVertexAttribArray(4);
+    glVertexAttribDivisor(4, 1);
+    g_glState.bindVertexArray(0);
+
+    glGenTextures(1, &m_heightTexture);
+    g_glState.bindTexture(0, GL_TEXTURE_2D, m_heightTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);        // around the longitudes
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); // at the poles
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_heightmapWidth, m_heightmapWidth / 2, 0, GL_RED, GL_FLOAT, m_heightmap.data());
+    g_glState.bindTexture(0, GL_TEXTURE_2D, 0);
+    std::vector<float>().swap(m_heightmap); // the GPU samples it, the culling only needs m_heightScale
+}
+
+float PlanetTerrain::range(const int depth) const
+{
+    // geometric error: the length of a grid quad, where a face spans a quarter of a great circle and each level
+    // halves the patch size; its projection is above the pixel error closer than this
+    const float quadLength = glm::half_pi<float>() / (float)(1 << depth) / m_gridSize;
+    return quadLength * m_rangeScale;
+}
+
+float PlanetTerrain::projectionScale(const Camera &camera, const float viewportHeight)
+{
+    return viewportHeight / (2.0f * std::tan(glm::radians(camera.getFov()) * 0.5f));
+}
+
+BoundingSphere PlanetTerrain::patchBounds(const int face, const glm::vec2 &origin, const float size, const float heightMargin) const
+{
+    // sphere around the corners, edge midpoints and center of the patch, at the lowest and highest altitude
+    BoundingSphere bounds;
+    bounds.center = spherify(face, origin + 0.5f * size) * (1.0f + 0.5f * heightMargin);
+    float radius2 = 0.0f;
+    for (int j = 0; j <= 2; ++j)
+    {
+        for (int i = 0; i <= 2; ++i)
+        {
+            const glm::vec3 p = spherify(face, origin + 0.5f * size * glm::vec2(i, j));
+            radius2 = std::max(radius2, glm::max(glm::dot(p - bounds.center, p - bounds.center),
+                                                 glm::dot(p * (1.0f + heightMargin) - bounds.center, p * (1.0f + heightMargin) - bounds.center)));
+        }
+    }
+    bounds.radius = 1.05f * sqrtf(radius2); // the patch edges bulge a little between the samples
+    return bounds;
+}
+
+// A point at most 1 + heightScale from the center can only be seen if its angle to the camera direction is below
+// the angle of the horizon plus the angle at which a summit of that height rises above it
+bool PlanetTerrain::belowHorizon(const BoundingSphere &bounds) const
+{
+    const float cameraDistance = glm::length(m_camera);
+    const float centerDistance = glm::length(bounds.center);
+    if (cameraDistance <= 1.0f || centerDistance <= bounds.radius)
+        return false;
+    const float visibleAngle = acosf(1.0f / cameraDistance) + acosf(1.0f / (1.0f + m_heightScale));
+    const float angle = acosf(glm::clamp(glm::dot(m_camera / cameraDistance, bounds.center / centerDistance), -1.0f, 1.0f));
+    return angle - asinf(std::min(1.0f, bounds.radius / centerDistance)) > visibleAngle;
+}
+
+void PlanetTerrain::select(const glm::vec3 &camera, const Frustum &frustum, const float projectionScale)
+{
+    m_camera = camera;
+    m_frustum = frustum;
+    // the ranges stay distance-based within the frame, as the morph needs, but shrink until the budget is met
+    m_framePixelError = m_pixelError;
+    for (int step = 0;; ++step)
+    {
+        m_rangeScale = projectionScale / m_framePixelError;
+        selectPatches();
+        if (m_patches.size() <= m_patchBudget || step == kMaxErrorSteps)
+            break;
+        m_framePixelError *= kErrorStep;
+    }
+}
+
+void PlanetTerrain::selectPatches()
+{
+    m_patches.clear();
+    m_culled = 0;
+    for (int face = 0; face < 6; ++face)
+        selectNode(face, 0, glm::vec2(-1.0f), 2.0f);
+}
+
+void PlanetTerrain::selectNode(const int face, const int depth, const glm::vec2 &origin, const float size)
+{
+    const BoundingSphere culling = patchBounds(face, origin, size, m_heightScale);
+    if (belowHorizon(culling) || !m_frustum.intersects(culling))
+    {
+        ++m_culled;
+        return;
+    }
+    const BoundingSphere surface = patchBounds(face, origin, size, 0.0f);
+    const float distance = glm::length(m_camera - surface.center) - surface.radius;
+    if (depth < (int)m_maxDepth && distance < range(depth))
+    {
+        const float half = 0.5f * size;
+        selectNode(face, depth + 1, origin, half);
+        selectNode(face, depth + 1, origin + glm::vec2(half, 0.0f), half);
+        selectNode(face, depth + 1, origin + glm::vec2(0.0f, half), half);
+        selectNode(face, depth + 1, origin + glm::vec2(half, half), half);
+        return;
+    }
+    m_patches.push_back(Patch{face, depth, origin, size});
+}
+
+void PlanetTerrain::render(const glm::mat4 &model, const MaterialHandle material, const GLuint pickId)
+{
+    if (m_patches.empty())
+        return;
+    const SceneProgram &program = g_terrainProgram;
+    program.use();
+    program.modelMat.set(model);
+    program.pickId.set(pickId);
+    program.cameraLocal.set(m_camera);
+    program.heightScale.set(m_heightScale);
+    program.gridSize.set((float)m_gridSize);
+    g_materials.get(material).apply(program); // the terrain has its own variant, whatever the material says
+    g_glState.bindTexture(2, GL_TEXTURE_2D, m_heightTexture); // 0 is the albedo
+    program.heightMap.set(2);
+    // the parent range ends where the parent would not have been subdivided: fully morphed there; the shader
+    // halves the range of the depth-0 patches at each level
+    const float morphEnd = range(0) * 2.0f;
+    program.morphRange.set(glm::vec2(kMorphStart * morphEnd, morphEnd));
+
+    // per patch: only its place on the cube and its depth
+    m_instances.resize(m_patches.size());
+    for (size_t i = 0; i < m_patches.size(); ++i)
+    {
+        const Patch &patch = m_patches[i];
+        m_instances[i].patch = glm::vec4(patch.origin, patch.size, (float)patch.depth);
+        m_instances[i].face = (float)patch.face;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    if (m_instances.size() > m_instanceCapacity)
+    {
+        m_instanceCapacity = std::max(m_instances.size(), m_patchBudget);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(PatchInstance) * m_instanceCapacity, nullptr, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(PatchInstance) * m_instances.size(), m_instances.data());
+
+    g_glState.bindVertexArray(m_vao);
+    glDrawElementsInstanced(GL_TRIANGLES, m_gridIndexCount, GL_UNSIGNED_SHORT, 0, m_instances.size());
+}
+
+size_t PlanetTerrain::patchCount() const { return m_patches.size(); }
+
+size_t PlanetTerrain::triangleCount() const { return m_patches.size() * 2 * m_gridSize * m_gridSize; }
+
+size_t PlanetTerrain::culledCount() const { return m_culled; }
+
+float PlanetTerrain::pixelError() const { return m_framePixelError; }
@@ -0,0 +1,98 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/gl.h>
+#include "bounds.h"
+#include "shaderprogram.h"
+#include "material.h"
+
+class Camera;
+
+extern SceneProgram g_terrainProgram; // vertex and fragment shaders compiled with TERRAIN
+
+// Planet surface as a quadtree of patches on each face of a cube-sphere (CDLOD, Strugar 2009).
+// A patch is subdivided while the projected size of its grid quads, its screen-space error, is above a target
+// in pixels; the target is raised for the frame when more patches than the budget would be selected, so the
+// patch count stays bounded from orbit down to the surface. Every patch draws the same grid, all of them in
+// one instanced draw: the vertex shader places it on the sphere, displaces it from a heightmap and morphs its
+// odd vertices onto the parent grid near the end of its range, without cracks.
+// Works in the object space of a unit sphere, placed by the model matrix.
+class PlanetTerrain
+{
+public:
+  // gridSize: quads per patch side; maxDepth: deepest quadtree level; heightScale: relief, relative to the radius;
+  // pixelError: projected quad size above which a patch is subdivided; patchBudget: most patches selected
+  explicit PlanetTerrain(const size_t gridSize = 32, const size_t maxDepth = 16, const float heightScale = 0.02f,
+                         const float pixelError = 4.0f, const size_t patchBudget = 96, const size_t heightmapWidth = 1024,
+                         const unsigned int seed = 0);
+  ~PlanetTerrain();
+  PlanetTerrain(const PlanetTerrain &) = delete;
+  PlanetTerrain &operator=(const PlanetTerrain &) = delete;
+
+  // Uploads the patch grid and the heightmap (needs a GL context)
+  void init();
+  // Chooses the patches for this camera position and frustum, both in object space; horizon and frustum culled.
+  // projectionScale: pixels covered by a unit length seen at a unit distance (see projectionScale())
+  void select(const glm::vec3 &camera, const Frustum &frustum, const float projectionScale);
+  // Draws the patches of the last select() (the morph depends on its camera position); pickId as in Mesh::render
+  void render(const glm::mat4 &model, const MaterialHandle material, const GLuint pickId = 0);
+
+  // viewportHeight / (2 tan(fov / 2)) for a camera and a viewport of the given height
+  static float projectionScale(const Camera &camera, const float viewportHeight);
+
+  size_t patchCount() const; // selected by the last select()
+  size_t triangleCount() const;
+  size_t culledCount() const; // quadtree nodes rejected by the horizon or the frustum in the last select()
+  float pixelError() const;   // target of the last select(), raised above the constructor one to fit the budget
+
+private:
+  struct Patch
+  {
+    int face;
+    int depth;
+    glm::vec2 origin; // lower corner on the cube face, in [-1, 1]^2
+    float size;
+  };
+
+  // Per-instance attributes of a patch, read by the TERRAIN vertex shader
+  struct PatchInstance
+  {
+    glm::vec4 patch; // origin, size, depth
+    float face;
+  };
+
+  void selectNode(const int face, const int depth, const glm::vec2 &origin, const float size);
+  // heightMargin: 0 for the undisplaced patch (LOD distances, same as the shader morph), m_heightScale for culling
+  BoundingSphere patchBounds(const int face, const glm::vec2 &origin, const float size, const float heightMargin) const;
+  bool belowHorizon(const BoundingSphere &bounds) const;
+  void selectPatches();
+  float range(const int depth) const; // distance below which a node of this depth is subdivided
+
+  size_t m_gridSize;
+  size_t m_maxDepth;
+  float m_heightScale;
+  float m_pixelError;
+  size_t m_patchBudget;
+  size_t m_heightmapWidth;
+  std::vector<float> m_heightmap; // equirectangular, in [0, 1]; dropped once uploaded
+
+  glm::vec3 m_camera = glm::vec3(0.0f);
+  Frustum m_frustum;
+  float m_rangeScale = 0.0f; // projection scale over the pixel error of the frame
+  float m_framePixelError = 0.0f;
+  std::vector<Patch> m_patches;
+  size_t m_culled = 0;
+  std::vector<PatchInstance> m_instances;
+
+  GLuint m_vao = 0;
+  GLuint m_gridVbo = 0;
+  GLuint m_gridIbo = 0;
+  GLsizei m_gridIndexCount = 0;
+  GLuint m_instanceVbo = 0;
+  size_t m_instanceCapacity = 0;
+  GLuint m_heightTexture = 0;
+};
+
+#endif // TERRAIN_H
@@ -0,0 +1,140 @@
+// ----------------------------------------------------------------------------
+// bvhbench.cpp
+//
+// Description: Build, refit and query times of the Bvh over 10k, 100k and 1M
+//              bodies on asteroid-belt orbits, against a linear scan of the
+//              same bodies.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <glm/ext.hpp>
+#include "bvh.h"
+#include "orbit.h"
+#include "camera.h"
+
+
+static double seconds(const std::chrono::high_resolution_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static std::vector<BoundingSphere> bodiesAt(const std::vector<OrbitParams> &orbits, const float time)
+{
+  std::vector<BoundingSphere> bodies(orbits.size());
+  for (size_t i = 0; i < orbits.size(); ++i)
+  {
+    bodies[i].center = OrbitalBelt::position(orbits[i], time);
+    bodies[i].radius = orbits[i].scale; // unit sphere meshes
+  }
+  return bodies;
+}
+
+int main()
+{
+  const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+  Camera camera;
+  camera.setAspectRatio(4.0f / 3.0f);
+  camera.setFar(200.0f);
+  camera.setPosition(glm::vec3(0.0f, 20.0f, 45.0f));
+  camera.setFront(glm::normalize(-camera.getPosition()));
+  const Frustum frustum = camera.computeFrustum();
+  const size_t queryCount = 1000;
+
+  std::printf("%8s %10s %10s %10s | %10s %10s %8s | %10s %10s | %10s %10s\n", "bodies", "build 1t", "build all", "refit",
+              "frustum", "linear", "visible", "sphere", "linear", "ray", "linear");
+  std::printf("%8s %10s %10s %10s | %10s %10s %8s | %10s %10s | %10s %10s\n", "", "(ms)", "(ms)", "(ms)",
+              "(ms)", "(ms)", "", "(us)", "(us)", "(us)", "(us)");
+  const size_t counts[] = {10000, 100000, 1000000};
+  for (const size_t count : counts)
+  {
+    const std::vector<OrbitParams> orbits = OrbitalBelt::genAsteroidBelt(count, 4.0f, 40.0f, 0.02f, 0.06f);
+    const std::vector<BoundingSphere> bodies = bodiesAt(orbits, 0.0f);
+    Bvh bvh;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    bvh.build(bodies, 1);
+    const double buildSingle = seconds(start);
+    start = std::chrono::high_resolution_clock::now();
+    bvh.build(bodies, cores);
+    const double buildParallel = seconds(start);
+
+    // one second later every body has moved along its orbit
+    const std::vector<BoundingSphere> moved = bodiesAt(orbits, 1.0f);
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < count; ++i)
+      bvh.update(i, moved[i]);
+    bvh.refit();
+    const double refit = seconds(start);
+
+    std::vector<uint32_t> visible;
+    start = std::chrono::high_resolution_clock::now();
+    bvh.queryFrustum(frustum, visible);
+    const double frustumTime = seconds(start);
+    size_t linearVisible = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < count; ++i)
+      linearVisible += frustum.intersects(moved[i]);
+    const double frustumLinear = seconds(start);
+    if (linearVisible != visible.size())
+      std::printf("MISMATCH: frustum query found %zu bodies, linear scan %zu\n", visible.size(), linearVisible);
+
+    // random probes among the bodies
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> coord(-40.0f, 40.0f);
+    std::vector<glm::vec3> probes(queryCount);
+    for (glm::vec3 &p : probes)
+      p = glm::vec3(coord(rng), 0.1f * coord(rng), coord(rng));
+
+    std::vector<uint32_t> found;
+    size_t bvhFound = 0, linearFound = 0;
+    start = std::chrono::high_resolution_clock::now();
+    BoundingSphere probe;
+    probe.radius = 0.5f;
+    for (const glm::vec3 &p : probes)
+    {
+      found.clear();
+      probe.center = p;
+      bvh.querySphere(probe, found);
+      bvhFound += found.size();
+    }
+    const double sphereTime = seconds(start) / queryCount;
+    start = std::chrono::high_resolution_clock::now();
+    for (const glm::vec3 &p : probes)
+      for (size_t i = 0; i < count; ++i)
+        linearFound += glm::distance(p, moved[i].center) <= 0.5f + moved[i].radius;
+    const double sphereLinear = seconds(start) / queryCount;
+    if (bvhFound != linearFound)
+      std::printf("MISMATCH: sphere queries found %zu bodies, linear scan %zu\n", bvhFound, linearFound);
+
+    // rays from the camera through the probes
+    size_t bvhHits = 0, linearHits = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (const glm::vec3 &p : probes)
+    {
+      float t;
+      bvhHits += bvh.raycast(camera.getPosition(), glm::normalize(p - camera.getPosition()), t) >= 0;
+    }
+    const double rayTime = seconds(start) / queryCount;
+    start = std::chrono::high_resolution_clock::now();
+    for (const glm::vec3 &p : probes)
+    {
+      const glm::vec3 direction = glm::normalize(p - camera.getPosition());
+      float t, best = 1e30f;
+      int hit = -1;
+      for (size_t i = 0; i < count; ++i)
+        if (intersectRay(moved[i], camera.getPosition(), direction, t) && t < best)
+          best = t, hit = (int)i;
+      linearHits += hit >= 0;
+    }
+    const double rayLinear = seconds(start) / queryCount;
+    if (bvhHits != linearHits)
+      std::printf("MISMATCH: rays hit %zu bodies, linear scan %zu\n", bvhHits, linearHits);
+
+    std::printf("%8zu %10.2f %10.2f %10.2f | %10.3f %10.3f %8zu | %10.2f %10.1f | %10.2f %10.1f\n", count,
+                buildSingle * 1e3, buildParallel * 1e3, refit * 1e3, frustumTime * 1e3, frustumLinear * 1e3, visible.size(),
+                sphereTime * 1e6, sphereLinear * 1e6, rayTime * 1e6, rayLinear * 1e6);
+  }
+  return 0;
+}
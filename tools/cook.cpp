@@ -0,0 +1,213 @@
+// ----------------------------------------------------------------------------
+// cook.cpp
+//
+// Description: Cooks the shaders, the textures of media/ and the generated
+//              sphere meshes into one memory-mappable archive (assetarchive.h)
+//              with GPU-ready payloads: decoded pixels, optimized meshes.
+//              Usage: cookAssets <archive> <source directory>
+//              Cooking is incremental: an input whose content hash matches
+//              the entry of the previous archive is copied, not cooked again.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "assetarchive.h"
+#include "meshlibrary.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+
+// Inputs, relative to the source directory; the runtime looks them up by these names
+static const char *kShaders[] = {"vertexShader.glsl", "fragmentShader.glsl"};
+static const char *kTextures[] = {"media/earth.jpg", "media/moon.jpg"};
+// Meshes the application can ask for: the sphere levels of detail (see lod.h), with and without strips
+static const MeshGenerator kMeshGenerators[] = {MeshGenerator::Sphere, MeshGenerator::SphereStrip};
+static const size_t kMeshResolutions[] = {8, 16, 32, 64, 128};
+
+struct CookedAsset
+{
+  AssetEntry entry;
+  std::vector<unsigned char> payload;
+};
+
+static bool readFile(const std::string &filename, std::string &content)
+{
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  if (!file)
+    return false;
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  content = buffer.str();
+  return true;
+}
+
+static AssetEntry makeEntry(const std::string &name, const AssetType type, const uint64_t contentHash)
+{
+  AssetEntry entry;
+  std::memset(&entry, 0, sizeof(entry));
+  std::strncpy(entry.name, name.c_str(), sizeof(entry.name) - 1);
+  entry.type = type;
+  entry.contentHash = contentHash;
+  return entry;
+}
+
+// Copies the entry of the previous archive if its input did not change
+static bool reuse(const AssetArchive &previous, const AssetEntry &entry, std::vector<CookedAsset> &assets)
+{
+  const AssetEntry *old = previous.find(entry.name);
+  if (!old || old->type != entry.type || old->contentHash != entry.contentHash)
+    return false;
+  CookedAsset asset;
+  asset.entry = *old;
+  asset.payload.assign(previous.data(*old), previous.data(*old) + old->size);
+  assets.push_back(asset);
+  return true;
+}
+
+static void appendBytes(std::vector<unsigned char> &payload, const void *data, const size_t size)
+{
+  payload.insert(payload.end(), (const unsigned char *)data, (const unsigned char *)data + size);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 3)
+  {
+    std::fprintf(stderr, "usage: %s <archive> <source directory>\n", argv[0]);
+    return 1;
+  }
+  const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+  const std::string archiveName = argv[1];
+  const std::string sourceDir = std::string(argv[2]) + "/";
+  std::vector<CookedAsset> assets;
+  size_t cooked = 0, reused = 0;
+  {
+    const AssetArchive previous(archiveName);
+
+    for (const char *name : kShaders)
+    {
+      std::string source;
+      if (!readFile(sourceDir + name, source))
+      {
+        std::fprintf(stderr, "ERROR: cannot read %s%s\n", sourceDir.c_str(), name);
+        return 1;
+      }
+      CookedAsset asset;
+      asset.entry = makeEntry(name, AssetType::Shader, fnv1a(source.data(), source.size()));
+      if (reuse(previous, asset.entry, assets))
+      {
+        ++reused;
+        continue;
+      }
+      appendBytes(asset.payload, source.data(), source.size());
+      assets.push_back(asset);
+      ++cooked;
+    }
+
+    for (const char *name : kTextures)
+    {
+      std::string file;
+      if (!readFile(sourceDir + name, file))
+      {
+        std::fprintf(stderr, "ERROR: cannot read %s%s\n", sourceDir.c_str(), name);
+        return 1;
+      }
+      CookedAsset asset;
+      asset.entry = makeEntry(name, AssetType::Texture, fnv1a(file.data(), file.size()));
+      if (reuse(previous, asset.entry, assets))
+      {
+        ++reused;
+        continue;
+      }
+      int width, height, channels;
+      unsigned char *pixels = stbi_load_from_memory((const stbi_uc *)file.data(), (int)file.size(), &width, &height, &channels, 0);
+      if (!pixels)
+      {
+        std::fprintf(stderr, "ERROR: cannot decode %s: %s\n", name, stbi_failure_reason());
+        return 1;
+      }
+      asset.entry.width = width;
+      asset.entry.height = height;
+      asset.entry.channels = channels;
+      appendBytes(asset.payload, pixels, (size_t)width * height * channels);
+      stbi_image_free(pixels);
+      assets.push_back(asset);
+      ++cooked;
+    }
+
+    // the meshes have no input file: they are keyed by MeshLibrary::kGeneratorVersion and their parameters
+    for (const MeshGenerator generator : kMeshGenerators)
+      for (const size_t resolution : kMeshResolutions)
+      {
+        const MeshKey key{generator, resolution};
+        const std::string name = MeshLibrary::assetName(key);
+        CookedAsset asset;
+        asset.entry = makeEntry(name, AssetType::Mesh, MeshLibrary::contentHash(key));
+        if (reuse(previous, asset.entry, assets))
+        {
+          ++reused;
+          continue;
+        }
+        const std::shared_ptr<Mesh> mesh = MeshLibrary::cook(key);
+        const IndexArray &indices = mesh->getIndices();
+        asset.entry.vertexCount = mesh->getPositions().size() / 3;
+        asset.entry.indexCount = indices.size();
+        asset.entry.primitive = mesh->getPrimitive();
+        appendBytes(asset.payload, mesh->getPositions().data(), mesh->getPositions().size() * sizeof(float));
+        appendBytes(asset.payload, mesh->getNormals().data(), mesh->getNormals().size() * sizeof(float));
+        appendBytes(asset.payload, mesh->getTexCoords().data(), mesh->getTexCoords().size() * sizeof(float));
+        appendBytes(asset.payload, indices.data(), indices.size() * sizeof(unsigned int));
+        assets.push_back(asset);
+        ++cooked;
+      }
+  } // the previous archive is unmapped before being replaced
+
+  // header, entry table sorted by name for AssetArchive::find(), then the aligned payloads
+  std::sort(assets.begin(), assets.end(), [](const CookedAsset &a, const CookedAsset &b) {
+    return std::strcmp(a.entry.name, b.entry.name) < 0;
+  });
+  size_t offset = sizeof(AssetArchiveHeader) + assets.size() * sizeof(AssetEntry);
+  for (CookedAsset &asset : assets)
+  {
+    offset = (offset + kAssetAlignment - 1) / kAssetAlignment * kAssetAlignment;
+    asset.entry.offset = offset;
+    asset.entry.size = asset.payload.size();
+    offset += asset.payload.size();
+  }
+  const AssetArchiveHeader header = {kAssetArchiveMagic, kAssetArchiveVersion, (uint32_t)assets.size(), 0};
+  const std::string tmpName = archiveName + ".tmp";
+  {
+    std::ofstream out(tmpName.c_str(), std::ios::binary);
+    out.write((const char *)&header, sizeof(header));
+    for (const CookedAsset &asset : assets)
+      out.write((const char *)&asset.entry, sizeof(asset.entry));
+    for (const CookedAsset &asset : assets)
+    {
+      const size_t padding = asset.entry.offset - (size_t)out.tellp();
+      out.write("\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", padding);
+      out.write((const char *)asset.payload.data(), asset.payload.size());
+    }
+    if (!out)
+    {
+      std::fprintf(stderr, "ERROR: cannot write %s\n", tmpName.c_str());
+      return 1;
+    }
+  }
+  std::remove(archiveName.c_str());
+  if (std::rename(tmpName.c_str(), archiveName.c_str()) != 0)
+  {
+    std::fprintf(stderr, "ERROR: cannot replace %s\n", archiveName.c_str());
+    return 1;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+  std::printf("%s: %zu assets (%zu cooked, %zu unchanged), %.1f MB in %.0f ms\n", archiveName.c_str(), assets.size(),
+              cooked, reused, offset / (1024.0 * 1024.0), elapsed.count() * 1e3);
+  return 0;
+}
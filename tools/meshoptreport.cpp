@@ -0,0 +1,52 @@
+// ----------------------------------------------------------------------------
+// meshoptreport.cpp
+//
+// Description: Prints the post-transform vertex cache efficiency (ACMR and
+//              ATVR, FIFO caches of 16 and 32 entries) of the generated
+//              meshes before and after Mesh::optimize(); fails if the
+//              optimization makes the ACMR of any of them worse.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <memory>
+#include "mesh.h"
+#include "meshopt.h"
+
+
+// False if the optimization made the ACMR worse
+static bool report(const char *name, const size_t param, std::shared_ptr<Mesh> mesh)
+{
+  bool improved = true;
+  const std::shared_ptr<Mesh> optimized = mesh->clone();
+  optimized->optimize();
+  const size_t cacheSizes[] = {16, 32};
+  for (size_t cacheSize : cacheSizes)
+  {
+    const VertexCacheStats before = analyzeVertexCache(mesh->getIndices(), mesh->getPositions().size() / 3, cacheSize);
+    const VertexCacheStats after = analyzeVertexCache(optimized->getIndices(), optimized->getPositions().size() / 3, cacheSize);
+    std::printf("%-12s %6zu %6zu %10zu   %6.3f -> %6.3f   %6.3f -> %6.3f\n", name, param, cacheSize,
+                mesh->getIndices().size() / 3, before.acmr, after.acmr, before.atvr, after.atvr);
+    improved = improved && after.acmr <= before.acmr;
+  }
+  return improved;
+}
+
+int main()
+{
+  bool improved = true;
+  std::printf("%-12s %6s %6s %10s   %-16s   %-16s\n", "generator", "param", "cache", "triangles", "ACMR", "ATVR");
+  const size_t uvResolutions[] = {16, 64, 256};
+  for (size_t r : uvResolutions)
+    improved = report("uv sphere", r, Mesh::genSphere(r)) && improved;
+  for (size_t s = 2; s <= 5; ++s)
+    improved = report("icosphere", s, Mesh::genIcosphere(s)) && improved;
+  const size_t cubeResolutions[] = {8, 32, 64};
+  for (size_t r : cubeResolutions)
+    improved = report("cube sphere", r, Mesh::genCubeSphere(r)) && improved;
+  if (!improved)
+  {
+    std::printf("FAILED: the optimization made the ACMR worse\n");
+    return 1;
+  }
+  return 0;
+}
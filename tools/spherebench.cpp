@@ -0,0 +1,77 @@
+// ----------------------------------------------------------------------------
+// spherebench.cpp
+//
+// Description: Compares the sphere generators of Mesh (UV sphere, icosphere,
+//              cube sphere): triangle count against the maximum geometric
+//              error, i.e., the largest distance between the mesh surface and
+//              the unit sphere it approximates.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "mesh.h"
+
+
+// Closest point of the triangle (a, b, c) to p (Ericson, Real-Time Collision Detection, 5.1.5)
+static glm::vec3 closestPointOnTriangle(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+  const glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+  const float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+  if (d1 <= 0 && d2 <= 0)
+    return a;
+  const glm::vec3 bp = p - b;
+  const float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+  if (d3 >= 0 && d4 <= d3)
+    return b;
+  const float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    return a + ab * (d1 / (d1 - d3));
+  const glm::vec3 cp = p - c;
+  const float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+  if (d6 >= 0 && d5 <= d6)
+    return c;
+  const float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    return a + ac * (d2 / (d2 - d6));
+  const float va = d3 * d6 - d5 * d4;
+  if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+  const float denom = 1.0f / (va + vb + vc);
+  return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// Vertices lie on the sphere, so the error of a triangle is 1 minus its distance to the center
+static void report(const char *name, const size_t param, const Mesh &mesh)
+{
+  const FloatArray &pos = mesh.getPositions();
+  const IndexArray &indices = mesh.getIndices();
+  float maxError = 0;
+  size_t flipped = 0; // triangles not facing outwards, should stay 0
+  for (size_t i = 0; i < indices.size(); i += 3)
+  {
+    const glm::vec3 a(pos[3 * indices[i]], pos[3 * indices[i] + 1], pos[3 * indices[i] + 2]);
+    const glm::vec3 b(pos[3 * indices[i + 1]], pos[3 * indices[i + 1] + 1], pos[3 * indices[i + 1] + 2]);
+    const glm::vec3 c(pos[3 * indices[i + 2]], pos[3 * indices[i + 2] + 1], pos[3 * indices[i + 2] + 2]);
+    const glm::vec3 closest = closestPointOnTriangle(glm::vec3(0), a, b, c);
+    maxError = std::max(maxError, 1 - glm::length(closest));
+    if (glm::dot(glm::cross(b - a, c - a), a + b + c) < 0)
+      ++flipped;
+  }
+  std::printf("%-12s %6zu %10zu %10zu %14.6f %8zu\n", name, param, indices.size() / 3, pos.size() / 3, maxError, flipped);
+}
+
+int main()
+{
+  std::printf("%-12s %6s %10s %10s %14s %8s\n", "generator", "param", "triangles", "vertices", "max error", "flipped");
+  const size_t uvResolutions[] = {8, 16, 32, 64, 128, 256};
+  for (size_t r : uvResolutions)
+    report("uv sphere", r, *Mesh::genSphere(r));
+  for (size_t s = 0; s <= 6; ++s)
+    report("icosphere", s, *Mesh::genIcosphere(s));
+  const size_t cubeResolutions[] = {2, 4, 8, 16, 32, 64, 128};
+  for (size_t r : cubeResolutions)
+    report("cube sphere", r, *Mesh::genCubeSphere(r));
+  return 0;
+}
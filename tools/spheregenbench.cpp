@@ -0,0 +1,68 @@
+// ----------------------------------------------------------------------------
+// spheregenbench.cpp
+//
+// Description: Throughput of Mesh::genSphere, in generated vertices per
+//              second, for resolutions from 16 to 8192 (or the maximum given
+//              as first argument), single-threaded and on every core. The
+//              last column is the time to allocate the output arrays alone,
+//              on the calling thread whatever the thread count. They are not
+//              zeroed (UninitializedAllocator): their pages are first touched
+//              by the worker threads, so it stays small next to the fill.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "mesh.h"
+
+// Best time of a few runs, in seconds
+static double timeGenSphere(const size_t resolution, const size_t threadCount)
+{
+  const int runs = resolution <= 1024 ? 5 : 1;
+  double best = 1e30;
+  for (int r = 0; r < runs; ++r)
+  {
+    const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    std::shared_ptr<Mesh> mesh = Mesh::genSphere(resolution, threadCount);
+    const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+// Best time of a few runs to allocate the vectors genSphere fills: 8 floats per vertex, 6 indices per quad
+static double timeAllocation(const size_t resolution)
+{
+  const int runs = resolution <= 1024 ? 5 : 1;
+  double best = 1e30;
+  for (int r = 0; r < runs; ++r)
+  {
+    const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    FloatArray attributes(8 * (resolution + 1) * (resolution + 1));
+    IndexArray indices(6 * resolution * (resolution - 1));
+    const std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+int main(int argc, char **argv)
+{
+  const size_t maxResolution = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8192;
+  const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+  std::printf("%u cores\n", cores);
+  std::printf("%10s %12s %14s %16s %14s %16s %14s\n", "resolution", "vertices", "1 thread (ms)", "vertices/s", "all cores (ms)",
+              "vertices/s", "allocation (ms)");
+  for (size_t resolution = 16; resolution <= maxResolution; resolution *= 2)
+  {
+    const double vertices = (double)(resolution + 1) * (resolution + 1);
+    const double single = timeGenSphere(resolution, 1);
+    const double parallel = timeGenSphere(resolution, cores);
+    const double allocation = timeAllocation(resolution);
+    std::printf("%10zu %12.0f %14.3f %16.3e %14.3f %16.3e %14.3f\n", resolution, vertices,
+                single * 1e3, vertices / single, parallel * 1e3, vertices / parallel, allocation * 1e3);
+  }
+  return 0;
+}
@@ -0,0 +1,50 @@
+// ----------------------------------------------------------------------------
+// terrainreport.cpp
+//
+// Description: Patches and triangles selected by PlanetTerrain for a camera
+//              looking at the planet from the altitude where the application
+//              switches to the terrain down to the surface: fails when the
+//              triangle count varies by more than a set ratio.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <algorithm>
+#include <glm/ext.hpp>
+#include "terrain.h"
+#include "mesh.h"
+#include "camera.h"
+
+
+int main()
+{
+  // the application draws the terrain below 4 radii from the center (kTerrainDistance), in a 768 pixel high viewport
+  const float kMaxAltitude = 3.0f, kMinAltitude = 1e-3f, kViewportHeight = 768.0f;
+  const float kMaxRatio = 4.0f; // most and fewest triangles over the altitudes
+
+  PlanetTerrain terrain;
+  size_t fewest = 0, most = 0;
+  std::printf("%12s %10s %12s %10s %10s\n", "altitude", "patches", "triangles", "culled", "error px");
+  for (float altitude = kMaxAltitude; altitude > kMinAltitude; altitude *= 0.5f)
+  {
+    // camera above the planet, looking at its center, as the application camera (45 degrees, near 0.1 world units)
+    Camera camera;
+    camera.setAspectRatio(16.0f / 9.0f);
+    camera.setNear(std::min(0.1f, 0.5f * altitude));
+    camera.setFar(250.0f);
+    camera.setPosition(glm::vec3(0.0f, 0.0f, 1.0f + altitude));
+    camera.setFront(glm::vec3(0.0f, 0.0f, -1.0f));
+    terrain.select(camera.getPosition(), camera.computeFrustum(), PlanetTerrain::projectionScale(camera, kViewportHeight));
+    std::printf("%12.4f %10zu %12zu %10zu %10.1f\n", altitude, terrain.patchCount(), terrain.triangleCount(), terrain.culledCount(),
+                terrain.pixelError());
+    fewest = fewest == 0 ? terrain.triangleCount() : std::min(fewest, terrain.triangleCount());
+    most = std::max(most, terrain.triangleCount());
+  }
+  const float ratio = (float)most / std::max<size_t>(fewest, 1);
+  std::printf("most / fewest triangles: %.2f (at most %.2f)\n", ratio, kMaxRatio);
+  if (ratio > kMaxRatio)
+  {
+    std::printf("FAILED: the triangle count is not bounded over the altitudes\n");
+    return 1;
+  }
+  return 0;
+}